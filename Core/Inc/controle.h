@@ -0,0 +1,38 @@
+/*
+ * controle.h
+ *
+ * Pipeline de controle da bola: LerSensor -> CalculoPid -> SetaVelocidade,
+ * o mesmo no firmware (main.cpp) e na simulacao POSIX (main_posix.cpp).
+ * So o acesso ao sensor e ao ventilador muda entre os alvos: cada um
+ * define controleLeSensor() e controleAplicaDuty().
+ */
+
+#ifndef INC_CONTROLE_H_
+#define INC_CONTROLE_H_
+
+#include <cstdint>
+#include "miros.h"
+
+/* definidos pelo alvo; chamados pelas tarefas */
+uint16_t controleLeSensor(void);     /* distancia em mm; espera a medida */
+void controleAplicaDuty(float duty); /* % de duty do ventilador */
+
+extern rtos::OSPeriodicTask threadLerSensor;
+extern rtos::OSPeriodicTask threadCalculoPid;
+extern rtos::OSPeriodicTask threadSetaVelocidade;
+
+/* filas, parametros do PID e as tres tarefas periodicas (50 ticks);
+* depois de OS_init e antes de OS_run
+*/
+void controleStart(void *stkLer, uint32_t szLer, void *stkPid, uint32_t szPid,
+                   void *stkSeta, uint32_t szSeta);
+
+/* alterna o setpoint entre 300 e 200 mm; pode ser chamada de ISR */
+void controleBotao(void);
+
+#ifdef MIROS_BENCH
+/* linha pipeline_latency ja gravada em OS_benchResults[] */
+extern bool volatile controleLatenciaPronta;
+#endif
+
+#endif /* INC_CONTROLE_H_ */
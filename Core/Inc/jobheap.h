@@ -0,0 +1,87 @@
+/*
+ * jobheap.h
+ *
+ * Heap binario minimo de jobs aperiodicos, ordenado pelo deadline
+ * absoluto e, em caso de empate, pela ordem de chegada (seq). Jobs sem
+ * deadline (OS_NO_DEADLINE) ficam depois de todos os outros, em FIFO.
+ *
+ * Pertence ao consumidor da fila de jobs: nao e seguro para ISRs.
+ */
+
+#ifndef INC_JOBHEAP_H_
+#define INC_JOBHEAP_H_
+
+#include <cstdint>
+#include "miros.h"
+
+namespace rtos {
+
+template <uint16_t N>
+class OSJobHeap {
+public:
+	bool empty() const { return num == 0U; }
+	bool full() const { return num == N; }
+	uint16_t size() const { return num; }
+
+	/* O(log n); false com o heap cheio */
+	bool push(OSAperiodicTask *job) {
+		if (num == N) {
+			return false;
+		}
+		job->seq = nextSeq++;
+		uint16_t i = num++;
+		while (i > 0U) {
+			uint16_t parent = (uint16_t)((i - 1U) / 2U);
+			if (!before(job, heap[parent])) {
+				break;
+			}
+			heap[i] = heap[parent];
+			i = parent;
+		}
+		heap[i] = job;
+		return true;
+	}
+
+	/* retira o job mais urgente, O(log n); nulo se vazio */
+	OSAperiodicTask *pop() {
+		if (num == 0U) {
+			return (OSAperiodicTask *)0;
+		}
+		OSAperiodicTask *top = heap[0];
+		OSAperiodicTask *last = heap[--num];
+		uint16_t i = 0U;
+		for (;;) {
+			uint16_t child = (uint16_t)(2U * i + 1U);
+			if (child >= num) {
+				break;
+			}
+			if (child + 1U < num && before(heap[child + 1U], heap[child])) {
+				child++;
+			}
+			if (!before(heap[child], last)) {
+				break;
+			}
+			heap[i] = heap[child];
+			i = child;
+		}
+		heap[i] = last;
+		return top;
+	}
+
+private:
+	/* a deve executar antes de b? seq compara com aritmetica modular */
+	static bool before(OSAperiodicTask const *a, OSAperiodicTask const *b) {
+		if (a->deadline != b->deadline) {
+			return a->deadline < b->deadline;
+		}
+		return (int32_t)(a->seq - b->seq) < 0;
+	}
+
+	OSAperiodicTask *heap[N];
+	uint16_t num = 0U;
+	uint32_t nextSeq = 0U;
+};
+
+}
+
+#endif /* INC_JOBHEAP_H_ */
@@ -8,32 +8,173 @@
 #ifndef INC_MIROS_H_
 #define INC_MIROS_H_
 
+#include <cstdint>
+#include "miros_config.h"
+#include "readyset.h"
+
 namespace rtos {
 
 
 
+typedef void (*OSTimerHandler)(void *arg);
+
+/* no da fila de timeouts (lista delta ordenada por expiracao) */
+typedef struct OSTimer {
+    struct OSTimer *next; /* proximo no da lista */
+    uint32_t delta; /* ticks depois do no anterior */
+    OSTimerHandler handler; /* chamado no tick em que o no expira */
+    void *arg; /* argumento repassado ao handler */
+    bool armed; /* true enquanto estiver na lista */
+} OSTimer;
+
+/* fila de timeouts: o tick so decrementa a cabeca e so toca nos nos
+* que de fato expiram; armar custa uma busca na lista
+*/
+typedef struct {
+    OSTimer *head;
+} OSTimerQueue;
+
 /* Thread Control Block (TCB) */
+/* threads bloqueadas num objeto, por indice em OS_thread[] */
+typedef OSReadySet<MIROS_CFG_MAX_THREADS + 1> OSWaitList;
+
 typedef struct {
     void *sp; /* stack pointer */
-    uint32_t timeout; /* timeout delay down-counter */
+    OSTimer timeout; /* timeout do OS_delay e das esperas */
+    uint16_t index; /* indice em OS_thread[] */
+    void *stkTop; /* topo da pilha, onde um job abortado recomeca */
+    void *stkBase; /* fundo da pilha, alinhado em 8 */
+    bool restart; /* recomecar na proxima troca de contexto */
+    OSWaitList *waitList; /* lista em que esta bloqueada, ou nula */
+    uint32_t waitFlags; /* flags esperadas; ao acordar, as recebidas */
+    uint8_t waitMode; /* OS_FLAGS_* da espera por flags */
+    bool timedOut; /* a ultima espera terminou por timeout */
     /* ... other attributes associated with a thread */
 } OSThread;
 typedef void (*OSThreadHandler)();
 
+/* histograma em escala log2 de ciclos: o balde 0 vai ate 255, o balde k
+* cobre [2^(k+7), 2^(k+8)) e o ultimo acumula o resto
+*/
+const uint8_t OS_HIST_BUCKETS = 24U;
+
+typedef struct {
+	uint16_t bucket[OS_HIST_BUCKETS]; /* saturam em 0xFFFF */
+	uint32_t count;
+	uint32_t max;
+} OSHist;
+
 typedef struct {
+	OSHist exec; /* tempo de CPU do job */
+	OSHist response; /* da liberacao ao fim do job */
+	OSHist jitter; /* da liberacao ao inicio do job */
+} OSTaskStats;
+
+struct OSPeriodicTask;
+/* chamado na perda de deadline (overrun = job ainda executando na proxima
+* liberacao) com interrupcoes desabilitadas; devolve a politica a aplicar
+*/
+typedef uint8_t (*OSMissHandler)(struct OSPeriodicTask *me, bool overrun);
+
+typedef struct OSPeriodicTask {
 	OSThread my_Thread;
 	uint32_t Period;
-	uint32_t lastAtivation;
-	uint8_t myThreadIndex;
-	uint8_t myPeriodicTaskIndex;
+	uint32_t Offset; /* fase da primeira liberacao em ticks (< Period) */
+	uint32_t Deadline; /* deadline relativo em ticks (D <= Period) */
+	uint32_t Wcet; /* tempo de execucao de pior caso em us (0 = nao declarado) */
+	uint64_t nextRelease; /* proxima liberacao absoluta, em OS_time */
+	uint64_t deadline; /* deadline absoluto do job atual, em OS_time */
+	uint16_t myThreadIndex;
+	uint16_t myPeriodicTaskIndex;
+	uint16_t myPrio; /* slot de prioridade fixa (0 = mais prioritaria) */
 	OSThreadHandler myTask;
+	OSTimer release; /* proxima liberacao periodica */
+	uint16_t heapIdx; /* posicao no heap EDF (OS_NO_INDEX = fora do heap) */
+	uint8_t missPolicy; /* OS_MISS_* */
+	OSMissHandler missHandler; /* so com OS_MISS_HANDLER */
+	uint32_t misses; /* perdas de deadline detectadas */
+	uint32_t skipped; /* jobs descartados pela politica */
+	uint32_t aborted; /* jobs abortados pela politica */
+	uint8_t lateJobs; /* liberacoes adiadas por OS_MISS_RUN_LATE */
+	bool lateRun; /* o job atual veio da fila de atrasados */
+	bool missCounted; /* perda do job atual ja contada na liberacao */
+	uint8_t mutexHeld; /* OSMutex travados pelo job atual */
+	uint32_t budgetCycles; /* Wcet em ciclos (0 = sem orcamento) */
+	uint32_t execCycles; /* ciclos do job atual ate a ultima troca */
+	uint32_t execMax; /* maior tempo de execucao de job observado */
+	uint32_t budgetOverruns; /* jobs que passaram do orcamento */
+	uint8_t budgetAction; /* OS_BUDGET_* */
+	bool overBudget; /* o job atual ja passou do orcamento */
+#if MIROS_CFG_STATS
+	uint32_t releaseStamp; /* DWT->CYCCNT da liberacao do job atual */
+	OSTaskStats stats;
+#endif
 
 } OSPeriodicTask;
 
+typedef void (*OSJobHandler)(void *arg);
+
+/* job aperiodico: o servidor executa primeiro o de menor deadline */
 typedef struct {
 	OSThreadHandler myTask;
+	OSJobHandler myJob; /* chamado com arg */
+	void *arg; /* carga do job */
+	uint64_t deadline; /* deadline absoluto em OS_time (OS_NO_DEADLINE = sem) */
+	uint32_t seq; /* ordem de chegada, desempata deadlines iguais */
 
 } OSAperiodicTask;
+
+/* reposicao de capacidade agendada do servidor esporadico */
+typedef struct {
+	uint64_t at; /* instante da reposicao, em OS_time */
+	uint32_t amount; /* ticks devolvidos ao budget */
+} OSReplenishment;
+
+/* Servidor esporadico: thread com prioridade de tarefa periodica
+* (periodo Ts, capacidade Cs) que executa as tarefas aperiodicas
+* enfileiradas enquanto tiver budget. O que for consumido a partir de uma
+* ativacao volta ao budget Ts ticks depois dessa ativacao.
+*/
+typedef struct {
+	OSPeriodicTask task; /* thread e slot de prioridade do servidor */
+	uint32_t capacity; /* Cs em ticks */
+	uint32_t budget; /* ticks ainda disponiveis */
+	uint32_t consumed; /* ticks consumidos na ativacao atual */
+	uint64_t activeSince; /* inicio da ativacao atual */
+	bool active; /* servidor ativo (pronto ou executando) */
+	OSTimer replenishTimer; /* dispara a reposicao mais antiga */
+	OSReplenishment replenish[MIROS_CFG_SS_REPLENISH_LEN];
+	uint8_t replenishHead;
+	uint8_t replenishNum;
+} OSSporadicServer;
+
+/* mutex com protocolo de teto de prioridade imediato: ao travar, o dono
+* passa a ter o teto (prioridade da usuaria mais prioritaria) e nenhuma
+* outra usuaria chega a executar ate ele soltar; lock nunca bloqueia.
+* Em EDF o slot RM serve como nivel de preempcao (SRP).
+*/
+typedef struct {
+	OSPeriodicTask *ceilTask; /* usuaria mais prioritaria (define o teto) */
+	OSPeriodicTask *owner; /* dono atual, nulo se livre */
+	uint16_t prevCeil; /* teto do sistema antes deste lock */
+	OSPeriodicTask *prevOwner; /* dono do teto anterior */
+} OSMutex;
+
+/* semaforo contador com lista de espera; give pode ser chamado de ISRs */
+typedef struct {
+	uint32_t count;
+	uint32_t max;
+	OSWaitList waiters;
+#if MIROS_CFG_TRACE
+	uint8_t traceId; /* identifica o semaforo no trace */
+#endif
+} OSSem;
+
+/* grupo de 32 flags de evento; set/clear podem ser chamados de ISRs */
+typedef struct {
+	uint32_t flags;
+	OSWaitList waiters;
+} OSEventFlags;
 void osAperiodicWrapper();
 void desativarPreempcao();
 void reativarPreempcao();
@@ -43,21 +184,133 @@ void AperiodicServerStart();
 
 void AperiodicServerStop();
 
+/* politica aplicada quando a tarefa perde um deadline: no fim de um job
+* atrasado (SKIP descarta o job seguinte) ou na liberacao seguinte com o
+* job ainda executando (SKIP descarta a nova liberacao, RUN_LATE a enfileira
+* e ABORT recomeca a thread com o novo job). ABORT com OSMutex travado ou
+* com a preempcao desativada vira RUN_LATE. Os contadores misses/skipped/aborted ficam na tarefa.
+*/
+void OSPeriodicTask_setMissPolicy(OSPeriodicTask *me, uint8_t policy,
+    OSMissHandler handler = (OSMissHandler)0);
+
+/* acao de orcamento; com OSMutex travado SUSPEND e ABORT so contam */
+void OSPeriodicTask_setBudgetAction(OSPeriodicTask *me, uint8_t action);
+
+#if MIROS_CFG_STATS
+/* copia coerente dos histogramas da tarefa */
+void OS_statsSnapshot(OSPeriodicTask const *me, OSTaskStats *out);
+void OS_statsReset(OSPeriodicTask *me);
+/* envia os histogramas de todas as tarefas em texto pela porta 0 do ITM
+* (SWV); chamar de uma thread de baixa prioridade ou do debugger
+*/
+void OS_statsDump(void);
+#endif
+
+/* cria o servidor esporadico (um por sistema) com periodo e capacidade
+* em ticks; passa pelo controle de admissao como tarefa (Ts, Cs) e
+* devolve false se o conjunto ficaria inescalonavel. Com o servidor
+* criado a idle thread deixa de executar tarefas aperiodicas.
+*/
+bool OSSporadicServer_start(OSSporadicServer *me,
+    void *stkSto, uint32_t stkSize,
+    uint32_t period, uint32_t capacity);
+
  uint32_t gcd(uint32_t a, uint32_t b);
  uint32_t lcm(uint32_t a, uint32_t b);
 const uint16_t TICKS_PER_SEC = 100U;
 
-void OSPeriodicTask_start(OSPeriodicTask *me,
+const uint16_t OS_MAX_THREADS = MIROS_CFG_MAX_THREADS;
+const uint16_t OS_NO_INDEX = 0xFFFFU; /* slot/posicao inexistente */
+const uint64_t OS_NO_DEADLINE = UINT64_MAX; /* job aperiodico sem deadline */
+
+/* timeouts das esperas, em ticks: 0 = so testa, sem bloquear */
+const uint32_t OS_WAIT_FOREVER = 0xFFFFFFFFU;
+
+/* modos de OSEventFlags_wait */
+const uint8_t OS_FLAGS_ANY = 0x00U; /* qualquer flag da mascara */
+const uint8_t OS_FLAGS_ALL = 0x01U; /* todas as flags da mascara */
+const uint8_t OS_FLAGS_CLEAR = 0x02U; /* consome as flags recebidas */
+
+/* politicas de perda de deadline, por tarefa */
+const uint8_t OS_MISS_ASSERT = 0U; /* Q_ERROR e reinicio (padrao) */
+const uint8_t OS_MISS_SKIP = 1U; /* descarta o proximo job */
+const uint8_t OS_MISS_RUN_LATE = 2U; /* o job seguinte roda atrasado */
+const uint8_t OS_MISS_ABORT = 3U; /* aborta o job atrasado e libera o novo */
+const uint8_t OS_MISS_HANDLER = 4U; /* o OSMissHandler escolhe */
+const uint8_t OS_MISS_MAX_LATE = 4U; /* jobs atrasados em fila; depois descarta */
+
+/* acao quando um job passa do Wcet declarado (MIROS_CFG_BUDGET) */
+const uint8_t OS_BUDGET_NOTIFY = 0U; /* so conta */
+const uint8_t OS_BUDGET_SUSPEND = 1U; /* suspende ate a proxima liberacao (padrao) */
+const uint8_t OS_BUDGET_ABORT = 2U; /* descarta o job */
+
+/* base de tempo do kernel: ticks desde a partida, 64 bits, sem volta */
+uint64_t OS_getTime(void);
+const uint32_t OS_TICK_US = 1000000U / TICKS_PER_SEC; /* duracao do tick em us */
+
+/* teste de admissao: a tarefa com o periodo e o deadline relativo (ticks,
+* 0 = periodo) e o WCET (us) dados mantem o conjunto escalonavel? Sempre
+* false se houver tarefa registrada sem WCET. Nao altera o kernel.
+*/
+bool OS_admissible(uint32_t period, uint32_t wcet, uint32_t deadline = 0U);
+
+/* registra a tarefa periodica; com wcet != 0 passa antes pelo teste de
+* admissao e devolve false, sem registrar nada, se o conjunto ficaria
+* inescalonavel. wcet = 0 registra sem analise e so e aceito enquanto
+* nenhuma tarefa foi admitida; e uma tarefa sem WCET faz as admissoes
+* seguintes falharem (inclusive a do servidor esporadico). offset (< period) atrasa a primeira liberacao e
+* defasa todas as seguintes; a analise continua sincrona, o que e seguro.
+* deadline (<= period, 0 = period) e o deadline relativo de cada job e
+* define a prioridade (deadline-monotonic).
+*/
+bool OSPeriodicTask_start(OSPeriodicTask *me,
 	    OSThreadHandler threadHandler,
-	    void *stkSto, uint32_t stkSize, uint32_t period);
+	    void *stkSto, uint32_t stkSize, uint32_t period,
+	    uint32_t wcet = 0U, uint32_t offset = 0U, uint32_t deadline = 0U);
 
-void OSAperiodicTask_start(OSAperiodicTask *me,
+/* enfileira um job aperiodico; pode ser chamada de ISRs e nao desabilita
+* interrupcoes para enfileirar. Devolve false com a fila cheia. O job
+* (me) precisa continuar valido ate ser executado.
+*/
+bool OSAperiodicTask_start(OSAperiodicTask *me,
     OSThreadHandler threadHandler);
 
+/* como acima, com carga e deadline relativo em ticks (0 = sem deadline:
+* executa depois dos jobs com deadline, em ordem de chegada)
+*/
+bool OSAperiodicTask_start(OSAperiodicTask *me,
+    OSJobHandler jobHandler, void *arg, uint32_t deadline = 0U);
+
 
 
 void OS_init(void *stkSto, uint32_t stkSize);
 
+void OSMutex_init(OSMutex *me);
+
+/* declara uma tarefa que usa o mutex; chamar depois de
+* OSPeriodicTask_start de todas as usuarias e antes de OS_run
+*/
+void OSMutex_addUser(OSMutex *me, OSPeriodicTask *user);
+
+/* so tarefas periodicas declaradas; travas aninhadas em ordem LIFO */
+void OSMutex_lock(OSMutex *me);
+void OSMutex_unlock(OSMutex *me);
+
+/* esperas bloqueiam a thread sem consumir CPU; a de maior prioridade
+* (slot RM, ou deadline em EDF) e acordada primeiro. Nao chamar da idle
+* thread, de ISRs nem com um OSMutex travado.
+*/
+void OSSem_init(OSSem *me, uint32_t count, uint32_t max);
+bool OSSem_take(OSSem *me, uint32_t timeout); /* false no timeout */
+bool OSSem_give(OSSem *me); /* false se ja estava em max */
+
+void OSEventFlags_init(OSEventFlags *me);
+/* devolve as flags que satisfizeram a espera, 0 no timeout */
+uint32_t OSEventFlags_wait(OSEventFlags *me, uint32_t mask,
+    uint8_t mode, uint32_t timeout);
+void OSEventFlags_set(OSEventFlags *me, uint32_t flags);
+void OSEventFlags_clear(OSEventFlags *me, uint32_t flags);
+
 /* callback to handle the idle condition */
 void OS_onIdle(void);
 
@@ -73,10 +326,33 @@ void OS_delay(uint32_t ticks);
 /* process all timeouts */
 void OS_tick(void);
 
+/* avanca ticks em que nenhum timeout expira (retorno do tickless idle);
+* chamar com interrupcoes DESABILITADAS
+*/
+void OS_tickSkip(uint32_t ticks);
+
+/* as funcoes OSTimerQueue_* devem ser chamadas com interrupcoes DESABILITADAS */
+void OSTimer_init(OSTimer *me, OSTimerHandler handler, void *arg);
+void OSTimerQueue_arm(OSTimerQueue *me, OSTimer *t, uint32_t ticks);
+void OSTimerQueue_disarm(OSTimerQueue *me, OSTimer *t);
+/* avanca um tick e chama o handler de cada no expirado */
+void OSTimerQueue_tick(OSTimerQueue *me);
+
+extern OSTimerQueue OS_timers; /* fila de timeouts do kernel */
+extern uint16_t OS_threadNum; /* threads criadas, contando a idle */
+
+#if MIROS_CFG_STACK_CHECK
+/* bytes de pilha ja usados pela thread (indice em OS_thread[], 0 = idle)
+* desde a criacao, pela pintura: inclui as ISRs e o PendSV que rodaram
+* sobre ela
+*/
+uint32_t OS_stackUsed(uint16_t threadIdx);
+#endif
+
 /* callback to configure and start interrupts */
 void OS_onStartup(void);
 
-uint8_t OSThread_start(
+uint16_t OSThread_start(
     OSThread *me,
     OSThreadHandler threadHandler,
     void *stkSto, uint32_t stkSize);
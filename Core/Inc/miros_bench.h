@@ -0,0 +1,123 @@
+/*
+ * miros_bench.h
+ *
+ * Micro-benchmarks do kernel medidos com o contador de ciclos DWT.
+ * So compilado com MIROS_BENCH definido; os resultados ficam em
+ * variaveis globais para leitura pelo debugger ou pelo Renode.
+ *
+ * Com MIROS_BENCH_SUITE a firmware nao usa sensor nem ventilador: main()
+ * inicia as tarefas da suite, que medem o kernel rodando (troca de
+ * contexto, OS_sched, semaforo, mutex, latencia de ISR), e o pipeline de
+ * controle com E/S falsa, que grava a sua latencia. OS_benchDone() vem
+ * com a tabela OS_benchResults[] completa.
+ */
+
+#ifndef INC_MIROS_BENCH_H_
+#define INC_MIROS_BENCH_H_
+
+#ifdef MIROS_BENCH
+
+#include <cstdint>
+
+namespace rtos {
+
+/* custo do tick: loop linear antigo x fila de timeouts */
+typedef struct {
+	uint32_t threads; /* numero de tarefas periodicas simuladas */
+	uint32_t legacyAvg; /* ciclos medios por tick, loop antigo */
+	uint32_t legacyMax; /* pior caso, loop antigo */
+	uint32_t timerAvg; /* ciclos medios por tick, fila delta */
+	uint32_t timerMax; /* pior caso, fila delta */
+} OSBenchTick;
+
+extern OSBenchTick OS_benchTick[3]; /* 4, 16 e 32 threads */
+
+/* custo de um job aperiodico na fila do kernel mantida em pending jobs:
+* enfileirar = OSAperiodicTask_start (push no anel), retirar =
+* osAperiodicWrapper (anel para o heap, pop do heap e um job vazio)
+*/
+typedef struct {
+	uint32_t pending; /* jobs ja pendentes durante a medicao */
+	uint32_t enqueueAvg;
+	uint32_t enqueueMax;
+	uint32_t dequeueAvg;
+	uint32_t dequeueMax;
+} OSBenchJobs;
+
+extern OSBenchJobs OS_benchJobs[3]; /* 8, 16 e 31 jobs pendentes (fila de 32) */
+
+/* uma linha por medicao, em ciclos do DWT; e o formato lido pelo
+* str-renode-bench.resc e gravado em JSON
+*/
+typedef struct {
+	char const *name; /* ex.: "ctxsw_fpu" */
+	uint32_t param; /* threads, jobs pendentes ou 0 */
+	uint32_t samples;
+	uint32_t min;
+	uint32_t avg;
+	uint32_t max;
+} OSBenchResult;
+
+const uint16_t OS_BENCH_MAX_RESULTS = 48U;
+
+/* minimo, maximo e soma de uma serie de medicoes */
+typedef struct {
+	uint32_t n;
+	uint32_t min;
+	uint32_t max;
+	uint64_t sum;
+} OSBenchAcc;
+
+static inline void OS_benchAccReset(OSBenchAcc *a) {
+	a->n = 0U;
+	a->min = 0xFFFFFFFFU;
+	a->max = 0U;
+	a->sum = 0U;
+}
+
+static inline void OS_benchAccAdd(OSBenchAcc *a, uint32_t cycles) {
+	a->n++;
+	a->sum += cycles;
+	a->min = (cycles < a->min) ? cycles : a->min;
+	a->max = (cycles > a->max) ? cycles : a->max;
+}
+
+static inline uint32_t OS_benchAccAvg(OSBenchAcc const *a) {
+	return (a->n == 0U) ? 0U : (uint32_t)(a->sum / a->n);
+}
+
+extern OSBenchResult OS_benchResults[OS_BENCH_MAX_RESULTS];
+extern uint32_t OS_benchCount; /* linhas preenchidas */
+extern bool volatile OS_benchFinished;
+
+/* habilita o DWT->CYCCNT */
+void OS_benchInit(void);
+
+/* roda todas as medicoes; chamar antes de OS_init */
+void OS_benchRun(void);
+
+/* acrescenta a serie como uma linha da tabela; tambem para medicoes
+* da aplicacao (ex.: latencia do pipeline em controle.cpp)
+*/
+void OS_benchAddResult(char const *name, uint32_t param, OSBenchAcc const *a);
+
+/* grava as linhas stack_used e marca o fim das medicoes; o Renode (ou
+* um breakpoint) para aqui
+*/
+void OS_benchDone(void);
+
+#ifdef MIROS_BENCH_SUITE
+/* cria as tarefas da suite; chamar depois de OS_init, no lugar das
+* tarefas da aplicacao, e seguir com OS_run
+*/
+void OS_benchSuiteStart(void);
+
+/* ciclos de um OS_tick, chamado pelo SysTick_Handler */
+void OS_benchTickSample(uint32_t cycles);
+#endif
+
+}
+
+#endif /* MIROS_BENCH */
+
+#endif /* INC_MIROS_BENCH_H_ */
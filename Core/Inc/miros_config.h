@@ -0,0 +1,96 @@
+/*
+ * miros_config.h
+ *
+ * Opcoes de compilacao do MiROS. Cada opcao pode ser sobrescrita
+ * com -D na configuracao de build do projeto.
+ */
+
+#ifndef INC_MIROS_CONFIG_H_
+#define INC_MIROS_CONFIG_H_
+
+/* numero maximo de threads, sem contar a idle (ate 1024) */
+#ifndef MIROS_CFG_MAX_THREADS
+#define MIROS_CFG_MAX_THREADS 32
+#endif
+
+/* tickless idle: a idle thread reprograma o SysTick para a proxima
+* expiracao da fila de timeouts e dorme ate la (1 = habilitado)
+*/
+#ifndef MIROS_CFG_TICKLESS
+#define MIROS_CFG_TICKLESS 0
+#endif
+
+/* politica de escalonamento das tarefas periodicas */
+#define MIROS_SCHED_RM  0 /* rate-monotonic, prioridade fixa (bitmap + CLZ) */
+#define MIROS_SCHED_EDF 1 /* earliest deadline first (heap de deadlines) */
+
+#ifndef MIROS_CFG_SCHED_POLICY
+#define MIROS_CFG_SCHED_POLICY MIROS_SCHED_RM
+#endif
+
+/* executivo ciclico: em OS_run pre-calcula as liberacoes do hiperperiodo
+* numa tabela e OS_tick so avanca um cursor (1 = habilitado). Se a tabela
+* nao couber em MIROS_CFG_RELEASE_TABLE_LEN eventos, as liberacoes seguem
+* pela fila de timeouts.
+*/
+#ifndef MIROS_CFG_RELEASE_TABLE
+#define MIROS_CFG_RELEASE_TABLE 0
+#endif
+
+#ifndef MIROS_CFG_RELEASE_TABLE_LEN
+#define MIROS_CFG_RELEASE_TABLE_LEN 64
+#endif
+
+/* reposicoes pendentes do servidor esporadico; com a fila cheia a ultima
+* reposicao absorve a nova (mais tarde, portanto seguro)
+*/
+#ifndef MIROS_CFG_SS_REPLENISH_LEN
+#define MIROS_CFG_SS_REPLENISH_LEN 8
+#endif
+
+/* orcamento de execucao por job medido com DWT->CYCCNT nas trocas de
+* contexto e verificado a cada tick (1 = habilitado)
+*/
+#ifndef MIROS_CFG_BUDGET
+#define MIROS_CFG_BUDGET 1
+#endif
+
+/* histogramas por tarefa de execucao, resposta e jitter de liberacao,
+* em ciclos (1 = habilitado; usa a contabilidade de MIROS_CFG_BUDGET)
+*/
+#ifndef MIROS_CFG_STATS
+#define MIROS_CFG_STATS 1
+#endif
+
+#if MIROS_CFG_STATS && !MIROS_CFG_BUDGET
+#error "MIROS_CFG_STATS precisa de MIROS_CFG_BUDGET"
+#endif
+
+/* trace binario de eventos do escalonador pelo ITM/SWO (1 = habilitado;
+* sem probe conectado cada evento custa so o teste do ITM)
+*/
+#ifndef MIROS_CFG_TRACE
+#define MIROS_CFG_TRACE 1
+#endif
+
+/* o evento leva o indice da thread em 8 bits (a idle e o 0): acima de
+* 255 threads o trace atribuiria eventos a thread errada
+*/
+#if MIROS_CFG_TRACE && MIROS_CFG_MAX_THREADS > 255
+#error "MIROS_CFG_TRACE so vai ate 255 threads; desligue o trace ou reduza MIROS_CFG_MAX_THREADS"
+#endif
+
+/* pilhas pintadas na criacao: o PendSV para o sistema (Q_ERROR) se a
+* palavra do fundo da pilha da thread que sai foi escrita, e
+* OS_stackUsed() da a marca d'agua (1 = habilitado)
+*/
+#ifndef MIROS_CFG_STACK_CHECK
+#define MIROS_CFG_STACK_CHECK 1
+#endif
+
+/* capacidade da fila de jobs aperiodicos (potencia de 2) */
+#ifndef MIROS_CFG_APERIODIC_QUEUE_LEN
+#define MIROS_CFG_APERIODIC_QUEUE_LEN 32
+#endif
+
+#endif /* INC_MIROS_CONFIG_H_ */
@@ -0,0 +1,59 @@
+/*
+ * miros_port.h
+ *
+ * Camada de porte do MiROS: o que depende do processador fica atras
+ * destas funcoes. O porte padrao e o Cortex-M4 (miros_port_cm4.cpp).
+ * Com MIROS_PORT_POSIX o mesmo kernel roda no Linux em fibras ucontext
+ * com tick e ciclos simulados (Port/posix).
+ */
+
+#ifndef INC_MIROS_PORT_H_
+#define INC_MIROS_PORT_H_
+
+#include <cstdint>
+#include "miros.h"
+
+#ifdef MIROS_PORT_POSIX
+#include "miros_port_posix.h" /* intrinsecos e registradores simulados */
+#else
+#include "stm32g4xx.h"
+#endif
+
+namespace rtos {
+
+/* PendSV (a troca de contexto) com a menor prioridade */
+void OS_portInit(void);
+
+/* padrao da parte livre das pilhas */
+const uint32_t OS_STACK_PAINT = 0xDEADBEEFU;
+
+/* monta o contexto inicial de uma thread que comeca em entry e pinta o
+* resto da pilha com OS_STACK_PAINT; me->index ja definido. Preenche
+* me->sp, me->stkTop e me->stkBase
+*/
+void OS_portThreadInit(OSThread *me, OSThreadHandler entry,
+    void *stkSto, uint32_t stkSize);
+
+/* troca o contexto salvo da thread por um que recomeca no
+* osPeriodicWrapper; interrupcoes DESABILITADAS
+*/
+void OS_portThreadRestart(OSThread *me);
+
+#ifndef MIROS_PORT_POSIX
+/* pede a troca de contexto para OS_next */
+static inline void OS_portPendSwitch(void) {
+	SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+}
+#endif
+
+/* estado do kernel usado pelo porte */
+extern OSThread * volatile OS_curr;
+extern OSThread * volatile OS_next;
+
+/* chamados pelo porte */
+void OS_switchHook(void);
+void osPeriodicWrapper();
+
+}
+
+#endif /* INC_MIROS_PORT_H_ */
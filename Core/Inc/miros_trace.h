@@ -0,0 +1,71 @@
+/*
+ * miros_trace.h
+ *
+ * Trace binario do escalonador pelas portas de estimulo do ITM (SWO).
+ * Cada evento e uma escrita de 32 bits na porta do seu tipo:
+ * bits 31..24 = argumento (thread, IRQ ou semaforo) e
+ * bits 23..0 = DWT->CYCCNT truncado. O decodificador (miros_trace.py)
+ * reconstroi o tempo completo porque o SysTick gera um evento a cada
+ * no maximo 2^24 ciclos. Com 8 bits de argumento o trace exige
+ * MIROS_CFG_MAX_THREADS <= 255 (miros_config.h).
+ */
+
+#ifndef INC_MIROS_TRACE_H_
+#define INC_MIROS_TRACE_H_
+
+#include <cstdint>
+#include "miros_config.h"
+#include "miros_port.h"
+
+namespace rtos {
+
+/* tipos de evento = porta de estimulo (a porta 0 fica para texto) */
+enum : uint8_t {
+	OS_EV_SWITCH = 1U, /* troca de contexto, arg = thread que entra */
+	OS_EV_RELEASE = 2U, /* liberacao de job, arg = thread */
+	OS_EV_DONE = 3U, /* fim de job, arg = thread */
+	OS_EV_MISS = 4U, /* perda de deadline, arg = thread */
+	OS_EV_ISR_ENTER = 5U, /* arg = numero da excecao (IPSR) */
+	OS_EV_ISR_EXIT = 6U,
+	OS_EV_SEM_TAKE = 7U, /* arg = id do semaforo */
+	OS_EV_SEM_BLOCK = 8U, /* take sem unidade: a thread bloqueia */
+	OS_EV_SEM_GIVE = 9U,
+	OS_EV_BUDGET = 10U, /* estouro de orcamento, arg = thread */
+};
+
+#if MIROS_CFG_TRACE
+
+extern uint32_t OS_traceDropped; /* eventos perdidos com a FIFO cheia */
+
+/* libera as portas do trace; o probe liga o ITM e o SWO */
+void OS_traceInit(void);
+
+/* ~10 ciclos; com o ITM desligado (sem probe) so testa e retorna */
+static inline void OS_traceEmit(uint8_t port, uint32_t arg) {
+	if ((ITM->TCR & ITM_TCR_ITMENA_Msk) == 0U
+			|| (ITM->TER & (1UL << port)) == 0U) {
+		return;
+	}
+	if (ITM->PORT[port].u32 == 0U) {
+		/* FIFO cheia: descarta em vez de esperar o SWO */
+		OS_traceDropped++;
+		return;
+	}
+	ITM->PORT[port].u32 = (arg << 24) | (DWT->CYCCNT & 0x00FFFFFFU);
+}
+
+#define OS_TRACE(ev_, arg_) ::rtos::OS_traceEmit((ev_), (uint32_t)(arg_))
+
+#else
+
+#define OS_TRACE(ev_, arg_) ((void)0)
+
+#endif /* MIROS_CFG_TRACE */
+
+/* marcam entrada e saida de uma ISR com o numero da excecao */
+#define OS_TRACE_ISR_ENTER() OS_TRACE(::rtos::OS_EV_ISR_ENTER, __get_IPSR())
+#define OS_TRACE_ISR_EXIT() OS_TRACE(::rtos::OS_EV_ISR_EXIT, __get_IPSR())
+
+}
+
+#endif /* INC_MIROS_TRACE_H_ */
@@ -0,0 +1,97 @@
+/*
+ * mpscqueue.h
+ *
+ * Fila circular limitada, sem trava, com varios produtores e um unico
+ * consumidor. Produtores podem ser threads ou ISRs de qualquer prioridade:
+ * a posicao e reservada com compare-and-swap (LDREX/STREX no Cortex-M4)
+ * e cada celula tem um numero de sequencia que diz ao consumidor quando o
+ * dado ja foi publicado. Nenhuma operacao desabilita interrupcoes.
+ *
+ * push e pop sao O(1); push devolve false com a fila cheia.
+ */
+
+#ifndef INC_MPSCQUEUE_H_
+#define INC_MPSCQUEUE_H_
+
+#include <cstdint>
+#include <atomic>
+
+namespace rtos {
+
+template <typename T, uint16_t N>
+class OSMpscQueue {
+public:
+	static_assert(N >= 2U && (N & (N - 1U)) == 0U, "N deve ser potencia de 2");
+
+	OSMpscQueue() : head(0U), tail(0U) {
+		for (uint32_t i = 0U; i < N; i++) {
+			cells[i].seq.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	/* enfileira; false se a fila estiver cheia */
+	bool push(T const &value) {
+		uint32_t pos = head.load(std::memory_order_relaxed);
+		Cell *c;
+		for (;;) {
+			c = &cells[pos & (N - 1U)];
+			uint32_t seq = c->seq.load(std::memory_order_acquire);
+			int32_t dif = (int32_t)(seq - pos);
+			if (dif == 0) {
+				if (head.compare_exchange_weak(pos, pos + 1U,
+				                               std::memory_order_relaxed)) {
+					break;
+				}
+			}
+			else if (dif < 0) {
+				return false; /* cheia */
+			}
+			else {
+				pos = head.load(std::memory_order_relaxed);
+			}
+		}
+		c->data = value;
+		c->seq.store(pos + 1U, std::memory_order_release);
+		return true;
+	}
+
+	/* desenfileira; so o consumidor chama. false se vazia ou se o
+	* produtor da proxima celula ainda nao terminou de publicar
+	*/
+	bool pop(T &out) {
+		Cell *c = &cells[tail & (N - 1U)];
+		uint32_t seq = c->seq.load(std::memory_order_acquire);
+		if ((int32_t)(seq - (tail + 1U)) < 0) {
+			return false;
+		}
+		out = c->data;
+		c->seq.store(tail + N, std::memory_order_release);
+		tail++;
+		return true;
+	}
+
+	/* ha um elemento publicado na frente da fila (visao do consumidor) */
+	bool empty() const {
+		Cell const *c = &cells[tail & (N - 1U)];
+		return c->seq.load(std::memory_order_acquire) != tail + 1U;
+	}
+
+	/* elementos reservados e ainda nao consumidos (aproximado) */
+	uint32_t size() const {
+		return head.load(std::memory_order_relaxed) - tail;
+	}
+
+private:
+	struct Cell {
+		std::atomic<uint32_t> seq;
+		T data;
+	};
+
+	Cell cells[N];
+	std::atomic<uint32_t> head; /* proxima posicao a reservar */
+	uint32_t tail; /* proxima posicao a consumir */
+};
+
+}
+
+#endif /* INC_MPSCQUEUE_H_ */
@@ -0,0 +1,73 @@
+/*
+ * msgqueue.h
+ *
+ * Fila de mensagens tipada, de capacidade fixa e sem copia: o produtor
+ * reserva um slot, preenche no lugar e faz commit; o consumidor recebe um
+ * ponteiro para o slot, le no lugar e o libera. Dois OSSem contam slots
+ * livres e mensagens prontas, entao tanto reserve quanto receive podem
+ * bloquear com timeout.
+ *
+ * Um produtor e um consumidor por fila; commit pode ser feito de ISRs
+ * (reserve com timeout 0).
+ */
+
+#ifndef INC_MSGQUEUE_H_
+#define INC_MSGQUEUE_H_
+
+#include <cstdint>
+#include "miros.h"
+
+namespace rtos {
+
+template <typename T, uint16_t N>
+class OSMsgQueue {
+public:
+	static_assert(N > 0U, "fila sem slots");
+
+	/* chamar antes de OS_run */
+	void init() {
+		head = 0U;
+		tail = 0U;
+		OSSem_init(&space, N, N);
+		OSSem_init(&ready, 0U, N);
+	}
+
+	/* slot livre para preencher, ou nulo no timeout */
+	T *reserve(uint32_t timeout = 0U) {
+		if (!OSSem_take(&space, timeout)) {
+			return (T *)0;
+		}
+		return &slots[head];
+	}
+
+	/* publica o slot reservado */
+	void commit() {
+		head = (head + 1U == N) ? 0U : (uint16_t)(head + 1U);
+		OSSem_give(&ready);
+	}
+
+	/* mensagem mais antiga, lida no lugar; nulo no timeout */
+	T *receive(uint32_t timeout = OS_WAIT_FOREVER) {
+		if (!OSSem_take(&ready, timeout)) {
+			return (T *)0;
+		}
+		return &slots[tail];
+	}
+
+	/* devolve o slot recebido ao produtor */
+	void release() {
+		tail = (tail + 1U == N) ? 0U : (uint16_t)(tail + 1U);
+		OSSem_give(&space);
+	}
+
+private:
+	T slots[N];
+	uint16_t head; /* proximo slot a reservar, so do produtor */
+	uint16_t tail; /* proximo slot a receber, so do consumidor */
+	OSSem space; /* slots livres */
+	OSSem ready; /* mensagens publicadas */
+};
+
+}
+
+#endif /* INC_MSGQUEUE_H_ */
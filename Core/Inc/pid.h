@@ -0,0 +1,129 @@
+/*
+ * pid.h
+ *
+ * Controlador PID discreto em float (FPU de precisao simples do M4F) e
+ * em ponto fixo Q31 (so inteiros, para nucleos sem FPU ou quando se quer
+ * o mesmo resultado bit a bit em qualquer alvo).
+ *
+ * Os ganhos continuos e o periodo de amostragem viram tres coeficientes
+ * na configuracao, entao o laco nao divide nada:
+ *
+ *   u = cp*e + I + cd*(e - e_ant),   I += ci*e,
+ *   cp = kp, ci = ki*ts, cd = kd/ts
+ *
+ * A saida e limitada a [outMin, outMax] com anti-windup por integracao
+ * condicional: com a saida saturada, o incremento do integrador so e
+ * aceito se puxar a saida de volta para dentro dos limites.
+ */
+
+#ifndef INC_PID_H_
+#define INC_PID_H_
+
+#include <cstdint>
+
+/* ganhos em unidades de saida por unidade de erro; ts em segundos */
+typedef struct {
+	float kp;
+	float ki;
+	float kd;
+	float ts;
+	float outMin;
+	float outMax;
+} PidConfig;
+
+typedef struct {
+	float cp;
+	float ci;
+	float cd;
+	float integ; /* termo integral, em unidades de saida */
+	float ePrev;
+	float outMin;
+	float outMax;
+} PidF;
+
+/* Q31: erro e saida sao fracoes de inScale e outScale (|x| < 1). Os
+* coeficientes normalizados sao guardados em Q31 divididos por 2^shift,
+* o que permite ganhos normalizados ate 2^30.
+*/
+typedef struct {
+	int32_t cp;
+	int32_t ci;
+	int32_t cd;
+	uint8_t shift;
+	int32_t integ; /* Q31 da saida */
+	int32_t ePrev;
+	int32_t outMin;
+	int32_t outMax;
+} PidQ31;
+
+/* coeficientes e estado zerado */
+void pidInitF(PidF *me, PidConfig const *cfg);
+/* troca os coeficientes e os limites mantendo o integrador */
+void pidTuneF(PidF *me, PidConfig const *cfg);
+
+void pidInitQ31(PidQ31 *me, PidConfig const *cfg, float inScale, float outScale);
+void pidTuneQ31(PidQ31 *me, PidConfig const *cfg, float inScale, float outScale);
+
+/* converte para Q31 com saturacao (x / scale) */
+int32_t pidToQ31(float x, float scale);
+
+/* um passo do controlador; erro = setpoint - medida */
+static inline float pidUpdateF(PidF *me, float erro) {
+	float pd = me->cp * erro + me->cd * (erro - me->ePrev);
+	float inc = me->ci * erro;
+	float u = pd + me->integ + inc;
+	me->ePrev = erro;
+	if (u > me->outMax) {
+		u = me->outMax;
+		if (inc < 0.0f) {
+			me->integ += inc;
+		}
+	}
+	else if (u < me->outMin) {
+		u = me->outMin;
+		if (inc > 0.0f) {
+			me->integ += inc;
+		}
+	}
+	else {
+		me->integ += inc;
+	}
+	return u;
+}
+
+static inline int32_t pidSat32(int64_t x) {
+	if (x > INT32_MAX) {
+		return INT32_MAX;
+	}
+	if (x < INT32_MIN) {
+		return INT32_MIN;
+	}
+	return (int32_t)x;
+}
+
+static inline int32_t pidUpdateQ31(PidQ31 *me, int32_t erro) {
+	uint8_t sh = 31U - me->shift;
+	int32_t de = pidSat32((int64_t)erro - me->ePrev);
+	int64_t pd = ((int64_t)me->cp * erro + (int64_t)me->cd * de) >> sh;
+	int64_t inc = ((int64_t)me->ci * erro) >> sh;
+	int64_t u = pd + me->integ + inc;
+	me->ePrev = erro;
+	if (u > me->outMax) {
+		u = me->outMax;
+		if (inc < 0) {
+			me->integ = pidSat32(me->integ + inc);
+		}
+	}
+	else if (u < me->outMin) {
+		u = me->outMin;
+		if (inc > 0) {
+			me->integ = pidSat32(me->integ + inc);
+		}
+	}
+	else {
+		me->integ = pidSat32(me->integ + inc);
+	}
+	return (int32_t)u;
+}
+
+#endif /* INC_PID_H_ */
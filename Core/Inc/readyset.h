@@ -0,0 +1,103 @@
+/*
+ * readyset.h
+ *
+ * Conjunto de indices prontos em bitmap de dois niveis: um bit em top
+ * para cada palavra de 32 bits nao vazia. Marcar, desmarcar e achar o
+ * menor indice custam tempo constante (dois CLZ) para ate 1024 indices.
+ *
+ * O indice 0 fica no bit 31 da primeira palavra, de modo que o CLZ
+ * devolve diretamente o menor indice marcado.
+ */
+
+#ifndef INC_READYSET_H_
+#define INC_READYSET_H_
+
+#include <cstdint>
+
+namespace rtos {
+
+template <uint16_t N>
+class OSReadySet {
+public:
+	static constexpr uint16_t WORDS = (N + 31U) / 32U;
+	static_assert(N > 0U && WORDS <= 32U, "OSReadySet suporta ate 1024 indices");
+
+	void set(uint16_t i) {
+		words[i >> 5] |= bit(i);
+		top |= bit(i >> 5);
+	}
+
+	void clear(uint16_t i) {
+		words[i >> 5] &= ~bit(i);
+		if (words[i >> 5] == 0U) {
+			top &= ~bit(i >> 5);
+		}
+	}
+
+	bool test(uint16_t i) const {
+		return (words[i >> 5] & bit(i)) != 0U;
+	}
+
+	bool empty() const {
+		return top == 0U;
+	}
+
+	/* menor indice marcado; exige !empty() */
+	uint16_t first() const {
+		uint16_t w = clz(top);
+		return (uint16_t)((w << 5) + clz(words[w]));
+	}
+
+	/* une outro conjunto a este (custo O(WORDS)) */
+	void merge(OSReadySet const &other) {
+		for (uint16_t w = 0U; w < WORDS; w++) {
+			words[w] |= other.words[w];
+		}
+		top |= other.top;
+	}
+
+	/* mantem so os indices tambem marcados em other */
+	void mask(OSReadySet const &other) {
+		top = 0U;
+		for (uint16_t w = 0U; w < WORDS; w++) {
+			words[w] &= other.words[w];
+			if (words[w] != 0U) {
+				top |= bit(w);
+			}
+		}
+	}
+
+	bool intersects(OSReadySet const &other) const {
+		for (uint16_t w = 0U; w < WORDS; w++) {
+			if ((words[w] & other.words[w]) != 0U) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void reset() {
+		top = 0U;
+		for (uint16_t w = 0U; w < WORDS; w++) {
+			words[w] = 0U;
+		}
+	}
+
+	/* mascara do indice i dentro da sua palavra */
+	static constexpr uint32_t bit(uint16_t i) {
+		return 0x80000000U >> (i & 31U);
+	}
+
+private:
+	/* gera a instrucao CLZ no Cortex-M4; nunca chamado com zero */
+	static uint16_t clz(uint32_t x) {
+		return (uint16_t)__builtin_clz(x);
+	}
+
+	uint32_t top;
+	uint32_t words[WORDS];
+};
+
+}
+
+#endif /* INC_READYSET_H_ */
@@ -0,0 +1,62 @@
+/*
+ * seqlock.h
+ *
+ * Snapshot sem trava para estado com um escritor e varios leitores
+ * (threads ou ISRs). Variante "latch" do seqlock: duas copias do dado e
+ * um contador de sequencia; o escritor atualiza uma copia de cada vez e o
+ * leitor le a copia que nao esta sendo escrita.
+ *
+ * Num nucleo so, o seqlock classico trava: um leitor mais prioritario que
+ * preempte o escritor no meio da escrita repete a leitura para sempre.
+ * Com as duas copias o leitor nunca espera pelo escritor; so repete se
+ * for preemptado por uma escrita completa. Nenhum lado desabilita
+ * interrupcoes.
+ */
+
+#ifndef INC_SEQLOCK_H_
+#define INC_SEQLOCK_H_
+
+#include <cstdint>
+#include <atomic>
+
+namespace rtos {
+
+template <typename T>
+class OSSeqLock {
+public:
+	OSSeqLock() : seq(0U) {}
+
+	/* so um escritor; tempo constante */
+	void write(T const &value) {
+		uint32_t s = seq.load(std::memory_order_relaxed);
+		seq.store(s + 1U, std::memory_order_relaxed); /* leitores vao p/ copia 1 */
+		std::atomic_thread_fence(std::memory_order_release);
+		copy[0] = value;
+		std::atomic_thread_fence(std::memory_order_release);
+		seq.store(s + 2U, std::memory_order_relaxed); /* leitores vao p/ copia 0 */
+		std::atomic_thread_fence(std::memory_order_release);
+		copy[1] = value;
+	}
+
+	/* qualquer numero de leitores; repete so se uma escrita terminou
+	* durante a leitura
+	*/
+	T read() const {
+		T value;
+		uint32_t s;
+		do {
+			s = seq.load(std::memory_order_acquire);
+			value = copy[s & 1U];
+			std::atomic_thread_fence(std::memory_order_acquire);
+		} while (seq.load(std::memory_order_relaxed) != s);
+		return value;
+	}
+
+private:
+	std::atomic<uint32_t> seq; /* par: copia 0 estavel, impar: copia 1 */
+	T copy[2];
+};
+
+}
+
+#endif /* INC_SEQLOCK_H_ */
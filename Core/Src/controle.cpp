@@ -0,0 +1,188 @@
+/*
+ * controle.cpp
+ *
+ * Tarefas do pipeline de controle (controle.h). Cada estagio le a
+ * mensagem no slot da fila, sem copia e sem mutex compartilhado.
+ */
+
+#include <cstdint>
+#include "controle.h"
+#include "miros.h"
+#include "miros_port.h"
+#include "msgqueue.h"
+#include "seqlock.h"
+#include "pid.h"
+#include "qassert.h"
+#ifdef MIROS_BENCH
+#include "miros_bench.h"
+#endif
+
+Q_DEFINE_THIS_FILE
+
+rtos::OSPeriodicTask threadLerSensor;
+rtos::OSPeriodicTask threadCalculoPid;
+rtos::OSPeriodicTask threadSetaVelocidade;
+
+/* setpoint e ganhos do PID: a ISR do botao e a unica escritora e o
+* CalculoPid le um snapshot coerente, sem secao critica. Ganhos em % de
+* duty por mm de erro
+*/
+typedef struct {
+	uint16_t setpoint;
+	float kp;
+	float ki;
+	float kd;
+} ParametrosPid;
+
+static rtos::OSSeqLock<ParametrosPid> parametrosPid;
+
+/* PID em float (FPU do M4F), amostrado a cada 50 ms; saida em % de duty
+* somada aos 61% de equilibrio
+*/
+static PidConfig pidConfig = { -0.01f, -0.001f, -0.001f, 0.050f, -30.0f, 30.0f };
+static PidF pid;
+
+typedef struct {
+	uint16_t distance;
+	uint32_t stamp; /* DWT->CYCCNT ao fim da leitura */
+} LeituraMsg;
+
+typedef struct {
+	float resultPid;
+	uint32_t stamp; /* herdado da leitura */
+} PidMsg;
+
+static rtos::OSMsgQueue<LeituraMsg, 2> filaLeitura;
+static rtos::OSMsgQueue<PidMsg, 2> filaPid;
+
+/* WCETs em us, que tambem sao o orcamento de cada job: o polling do
+* VL53L0X fica limitado a 40 ms; PID em float e escrita do PWM custam
+* dezenas de us, com folga para as ISRs cobradas da tarefa
+*/
+#define LER_WCET  40000U
+#define PID_WCET  1000U
+#define SETA_WCET 1000U
+
+/* esperas pela fila anterior vao no maximo ate deadline - offset, entao
+* um receive que expira ainda termina o job no prazo e uma leitura perdida
+* nao vira perda de deadline. PID: liberado em +2 com o deadline implicito
+* de 50 ticks; atuador: liberado em +3 com deadline de 10 ticks
+*/
+#define PID_OFFSET    2U
+#define PID_DEADLINE  50U
+#define PID_TIMEOUT   (PID_DEADLINE - PID_OFFSET)
+#define SETA_OFFSET   3U
+#define SETA_DEADLINE 10U
+#define SETA_TIMEOUT  (SETA_DEADLINE - SETA_OFFSET)
+
+#ifdef MIROS_BENCH
+/* latencia da leitura do sensor ate a escrita do PWM, em ciclos: vira a
+* linha pipeline_latency de OS_benchResults[] depois de
+* CONTROLE_LATENCIA_AMOSTRAS amostras
+*/
+#define CONTROLE_LATENCIA_AMOSTRAS 16U
+
+static rtos::OSBenchAcc pipelineLatency = { 0U, 0xFFFFFFFFU, 0U, 0U };
+bool volatile controleLatenciaPronta;
+#endif
+
+static void LerSensor() {
+	LeituraMsg *msg = filaLeitura.reserve();
+	if (msg == (LeituraMsg *)0) {
+		return; /* PID atrasado: a leitura anterior ainda nao foi consumida */
+	}
+	msg->distance = controleLeSensor();
+	msg->stamp = DWT->CYCCNT;
+	filaLeitura.commit();
+}
+
+static void CalculoPid() {
+	LeituraMsg *leitura = filaLeitura.receive(PID_TIMEOUT);
+	if (leitura == (LeituraMsg *)0) {
+		return;
+	}
+	PidMsg *saida = filaPid.reserve();
+	if (saida == (PidMsg *)0) {
+		filaLeitura.release();
+		return;
+	}
+	saida->stamp = leitura->stamp;
+	uint16_t medida = leitura->distance;
+	filaLeitura.release();
+	if (medida < 20U) {
+		medida = 20U;
+	}
+	if (medida > 950U) {
+		medida = 950U;
+	}
+
+	ParametrosPid p = parametrosPid.read();
+	/* ganhos novos: so recalcula os coeficientes, o integrador fica */
+	if (p.kp != pidConfig.kp || p.ki != pidConfig.ki || p.kd != pidConfig.kd) {
+		pidConfig.kp = p.kp;
+		pidConfig.ki = p.ki;
+		pidConfig.kd = p.kd;
+		pidTuneF(&pid, &pidConfig);
+	}
+	saida->resultPid = pidUpdateF(&pid, (float)p.setpoint - (float)medida);
+	filaPid.commit();
+}
+
+static void SetaVelocidade() {
+	PidMsg *msg = filaPid.receive(SETA_TIMEOUT);
+	if (msg == (PidMsg *)0) {
+		return;
+	}
+	controleAplicaDuty(msg->resultPid + 61.0f);
+#ifdef MIROS_BENCH
+	if (!controleLatenciaPronta) {
+		rtos::OS_benchAccAdd(&pipelineLatency, DWT->CYCCNT - msg->stamp);
+		if (pipelineLatency.n == CONTROLE_LATENCIA_AMOSTRAS) {
+			rtos::OS_benchAddResult("pipeline_latency", 0U, &pipelineLatency);
+			controleLatenciaPronta = true;
+#ifndef MIROS_BENCH_SUITE
+			rtos::OS_benchDone(); /* na suite quem fecha e a benchLo */
+#endif
+		}
+	}
+#endif
+	filaPid.release();
+}
+
+void controleStart(void *stkLer, uint32_t szLer, void *stkPid, uint32_t szPid,
+                   void *stkSeta, uint32_t szSeta) {
+	parametrosPid.write(ParametrosPid{ 300U, pidConfig.kp, pidConfig.ki, pidConfig.kd });
+	pidInitF(&pid, &pidConfig);
+	filaLeitura.init();
+	filaPid.init();
+
+	/* estagios defasados dentro do periodo: leitura em 0, PID em +2 e
+	* atuador em +3. Os tres declaram WCET, senao a admissao nao valeria
+	* para nenhum. Uma tarefa recusada deixaria o pipeline sem um estagio:
+	* para na partida (Q_ALLEGE executa o start mesmo com Q_NASSERT)
+	*/
+	Q_ALLEGE(rtos::OSPeriodicTask_start(&threadLerSensor, &LerSensor, stkLer, szLer, 50U,
+			LER_WCET, 0U));
+	Q_ALLEGE(rtos::OSPeriodicTask_start(&threadCalculoPid, &CalculoPid, stkPid, szPid, 50U,
+			PID_WCET, PID_OFFSET));
+	Q_ALLEGE(rtos::OSPeriodicTask_start(&threadSetaVelocidade, &SetaVelocidade, stkSeta, szSeta, 50U,
+			SETA_WCET, SETA_OFFSET, SETA_DEADLINE)); /* PWM no maximo 10 ticks apos a liberacao */
+
+	/* uma sobrecarga passageira custa um ciclo, nao um reinicio: leitura e
+	* atuador descartam o job seguinte e o PID roda atrasado para manter o
+	* integrador coerente. ABORT nao serve aqui: abortar entre receive() e
+	* release() perderia um slot da fila.
+	*/
+	rtos::OSPeriodicTask_setMissPolicy(&threadLerSensor, rtos::OS_MISS_SKIP);
+	/* leitura presa no sensor e suspensa e so continua no periodo seguinte */
+	rtos::OSPeriodicTask_setBudgetAction(&threadLerSensor, rtos::OS_BUDGET_SUSPEND);
+	rtos::OSPeriodicTask_setMissPolicy(&threadCalculoPid, rtos::OS_MISS_RUN_LATE);
+	rtos::OSPeriodicTask_setMissPolicy(&threadSetaVelocidade, rtos::OS_MISS_SKIP);
+}
+
+void controleBotao(void) {
+	/* ISR nao pode bloquear: escrita sem espera no seqlock */
+	ParametrosPid p = parametrosPid.read();
+	p.setpoint = (p.setpoint == 300U) ? 200U : 300U;
+	parametrosPid.write(p);
+}
@@ -1,7 +1,7 @@
 #include <cstdint>
 #include "miros.h"
 #include "qassert.h"
-#include "stm32g4xx.h"
+#include "miros_port.h"
 #include "interruptController.h"
 
 namespace rtos {
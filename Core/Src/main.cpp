@@ -33,9 +33,10 @@ extern "C"
 #include "ventilador.h"
 #include "core_cm4.h" // traz as definições de SCB e FPU
 #include "miros.h"
+#include "miros_bench.h"
+#include "controle.h"
 /*teste botao*/
 
-rtos :: MySemaphore mutex;
 #define VL53L0X_ADDR (0x52) //do datasheet
 
 I2C_HandleTypeDef hi2c1;
@@ -45,41 +46,23 @@ static void MX_GPIO_Init(void);
 static void MX_I2C1_Init(void);
 #define VL53L0X_TIMEOUT_MS 1000
 
-uint32_t stack_idleThread[40];
-uint32_t stack_LerSensor[128];
-uint32_t stack_CalculoPid[128];
+/* pilhas em palavras. Threads e ISRs usam a MSP, entao cada pilha leva,
+ * alem das chamadas da propria thread, o pior aninhamento sobre ela: EXTI
+ * e SysTick com frame de FPU (ate 0x68 bytes cada), o OS_tick (liberacoes,
+ * orcamento, trace, histogramas) e o PendSV (r4-r11, EXC_RETURN, s16-s31
+ * e o OS_switchHook), uns 600 bytes no pior caso. A idle com 40 palavras
+ * nao cobria nem isso. As linhas stack_used da suite de benchmarks dao o
+ * uso medido de cada uma, e com MIROS_CFG_STACK_CHECK um estouro para o
+ * sistema no PendSV.
+ */
+uint32_t stack_idleThread[192];
+uint32_t stack_LerSensor[320]; /* HAL_I2C_Mem_Read/Write por baixo */
+uint32_t stack_CalculoPid[256];
 uint32_t stack_SetaVelocidade[400];
 
-rtos ::OSPeriodicTask threadLerSensor;
-rtos ::OSPeriodicTask threadCalculoPid;
-rtos ::OSPeriodicTask threadSetaVelocidade;
 // Endereço do VL53L0X
 
 int32_t E = -1;
-double ultimoErro = 0;
-double erroIntegral = 0;
-
-double testePid(double medida, double setpoint)
-{
-  double erro = setpoint - medida;
-
-  double proporcional = -0.0001 * erro;
-  erroIntegral += erro * 0.050;
-  double integral = -0.00001 * erroIntegral;
-  double derivativo = -0.00001 * (erro - ultimoErro) / 0.050;
-
-  ultimoErro = erro;
-  if (proporcional + integral + derivativo < -0.3)
-  {
-    return -30;
-  }
-  if (proporcional + integral + derivativo > 0.3)
-  {
-    return 30;
-  }
-
-  return (proporcional + integral + derivativo) * 100;
-}
 void Error_Handler(void)
 {
   __disable_irq();
@@ -223,85 +206,38 @@ void SystemClock_Config(void)
   }
 }
 
-uint16_t setpointGlobal = 0;
-double resultPid;
-uint16_t distance = 0;
-void LerSensor()
+/* ganchos do pipeline (controle.h) */
+#ifndef MIROS_BENCH_SUITE
+uint16_t controleLeSensor(void)
 {
-  //E = distance;
-	if(mutex.tryLock()){
-
-   VL53L0X_ReadSingleSimple( &distance);
-		mutex.tryUnlock();
-	}
+  uint16_t distance = 0U;
+  VL53L0X_ReadSingleSimple(&distance);
+  return distance;
 }
-void SetaVelocidade()
-{
-  //float e = distance / 100;
-  // distance = 6.00;
-
-	if(mutex.tryLock()){
 
-  ventiladorSetDutyCycle(resultPid + 61);
-	mutex.tryUnlock();
-	}
-  // Usa o valor da distância
-  // Ex: enviar por UART, acionar algo, etc.
+void controleAplicaDuty(float duty)
+{
+  ventiladorSetDutyCycle(duty);
 }
-void CalculoPid()
+#else
+/* a suite roda o pipeline sem sensor nem ventilador, so pela latencia */
+uint16_t controleLeSensor(void)
 {
+  return 300U;
+}
 
- if(mutex.tryLock()){
-	  uint16_t medida = distance ; // 50 correção leitura do sensor
-	 if(distance<20){
-		 medida = 20;
-	 }
-	 if(distance>950){
-	 		 medida = 950;
-	 	 }
-	  double erro = setpointGlobal - medida;
-
-	  double proporcional = -0.0001 * erro;
-	  erroIntegral += erro * 0.050;
-	  double integral = -0.00001 * erroIntegral;
-	  double derivativo = -0.00001 * (erro - ultimoErro) / 0.050;
-
-	  ultimoErro = erro;
-	  if (proporcional + integral + derivativo < -0.3)
-	  {
-	    resultPid = -30;
-
-		  mutex.tryUnlock();
-	    return;
-	  }
-	  if (proporcional + integral + derivativo > 0.3)
-	  {
-	    resultPid = 30;
-
-		  mutex.tryUnlock();
-	    return;
-	  }
-
-	  resultPid = (proporcional + integral + derivativo) * 100;
-	  mutex.tryUnlock();
- }
-
-  // resultPid = testePid(distance-50,setpointGlobal)+61;
+void controleAplicaDuty(float duty)
+{
+  (void)duty;
 }
+#endif
 
 void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
 {
-	while(!mutex.tryLock()){}
-
-	if (setpointGlobal == 300){
-		  setpointGlobal = 200;
-	}
-	else{
-		setpointGlobal = 300;
-	}
-	mutex.tryUnlock();
-
+  (void)GPIO_Pin;
+  controleBotao();
 }
+
 void buttonInit(){
 
 	  // Clock para PC13 (botão)
@@ -322,16 +258,17 @@ void buttonInit(){
 
 int main(void)
 {
-  setpointGlobal = 300;
 
   SCB->CPACR |= (0xF << 20); // habilita acesso FPU
 
-  // no começo do main(), logo após habilitar CPACR:
-  FPU->FPCCR &= ~((1U << 30) | (1U << 31)); // desliga ASPEN e LSPEN
+  // empilhamento lazy da FPU (padrao do reset): o PendSV so salva s16-s31
+  // das threads que usaram a FPU, pelo EXC_RETURN
+  FPU->FPCCR |= FPU_FPCCR_ASPEN_Msk | FPU_FPCCR_LSPEN_Msk;
 
   HAL_Init();
   SystemClock_Config();
   MX_GPIO_Init();
+#ifndef MIROS_BENCH_SUITE /* a suite roda sem sensor nem ventilador (Renode) */
   MX_I2C1_Init();
 
   buttonInit();
@@ -342,19 +279,20 @@ int main(void)
   ventiladorSetDutyCycle(60.00);
 
   VL53L0X_InitSimple();
+#endif
 
-  rtos::OS_init(stack_idleThread, sizeof(stack_idleThread));
+#ifdef MIROS_BENCH
+  rtos::OS_benchRun();
+#endif
 
-  rtos::OSPeriodicTask_start(&threadLerSensor,
-                             &LerSensor,
-                             stack_LerSensor, sizeof(stack_LerSensor), 50u);
+  rtos::OS_init(stack_idleThread, sizeof(stack_idleThread));
 
-  rtos::OSPeriodicTask_start(&threadCalculoPid,
-                             &CalculoPid,
-                             stack_CalculoPid, sizeof(stack_CalculoPid), 50u);
+#ifdef MIROS_BENCH_SUITE
+  rtos::OS_benchSuiteStart();
+#endif
 
-  rtos::OSPeriodicTask_start(&threadSetaVelocidade,
-                             &SetaVelocidade,
-                             stack_SetaVelocidade, sizeof(stack_SetaVelocidade), 50u);
+  controleStart(stack_LerSensor, sizeof(stack_LerSensor),
+                stack_CalculoPid, sizeof(stack_CalculoPid),
+                stack_SetaVelocidade, sizeof(stack_SetaVelocidade));
   rtos::OS_run();
 }
@@ -31,9 +31,16 @@
 #include <cstdint>
 #include "miros.h"
 #include "qassert.h"
-#include "stm32g4xx.h"
+#include "miros_port.h"
+#if MIROS_CFG_TICKLESS
+#include "stm32g4xx_hal.h"
+#endif
 
 #include "semaforo.h"
+#include "readyset.h"
+#include "mpscqueue.h"
+#include "jobheap.h"
+#include "miros_trace.h"
 #include <limits>
 
 Q_DEFINE_THIS_FILE
@@ -46,30 +53,194 @@ OSThread * volatile OS_next; /* pointer to the next thread to run */
 OSPeriodicTask * volatile OSPeriodic_curr; /* pointer to the current thread */
 OSPeriodicTask * volatile OSPeriodic_next; /* pointer to the next thread to run */
 
-OSPeriodicTask *OSPeriodicTasks[32 + 1]; /* array of PeriodicTask started so far */
-uint8_t OS_periodicTaskNum=0; /* number of periodic PeriodicTask started */
+OSPeriodicTask *OSPeriodicTasks[OS_MAX_THREADS]; /* array of PeriodicTask started so far */
+uint16_t OS_periodicTaskNum=0; /* number of periodic PeriodicTask started */
+
+
+/* jobs aperiodicos: threads e ISRs enfileiram sem travar, o consumidor
+* (servidor esporadico ou idle thread) retira em O(1)
+*/
+OSMpscQueue<OSAperiodicTask *, MIROS_CFG_APERIODIC_QUEUE_LEN> OS_aperiodicQueue;
+/* jobs ja retirados do anel, em ordem de deadline; so o consumidor mexe */
+OSJobHeap<MIROS_CFG_APERIODIC_QUEUE_LEN> OS_jobHeap;
+
+static inline bool OS_jobsPending(void) {
+	return !OS_jobHeap.empty() || !OS_aperiodicQueue.empty();
+}
+
+/* job ja retirado do heap e ainda nao terminado; o servidor pode ter
+* ficado sem budget no meio dele
+*/
+static bool volatile OS_jobRunning;
 
 
-OSAperiodicTask *OSAperiodicTasks[32 + 1]; /* array of threads started so far */
-uint8_t OS_AperiodicTaskNum = 0;
 
+uint64_t volatile OS_time; /* ticks desde a partida, monotonico */
+
+OSTimerQueue OS_timers; /* delays e liberacoes periodicas */
+
+OSThread *OS_thread[OS_MAX_THREADS + 1]; /* array of threads started so far */
+OSReadySet<OS_MAX_THREADS + 1> OS_readySet; /* threads that are ready to run */
+/* tarefas periodicas com job liberado e nao concluido; difere de pronta
+* quando o job esta bloqueado num semaforo, flag ou OS_delay
+*/
+OSReadySet<OS_MAX_THREADS + 1> OS_jobActive;
+/* tarefas que perderam o deadline com OS_MISS_SKIP: a proxima liberacao
+* e descartada
+*/
+OSReadySet<OS_MAX_THREADS + 1> OS_skipNext;
+
+#if MIROS_CFG_BUDGET
+/* jobs suspensos por orcamento esgotado, retomados na proxima liberacao */
+OSReadySet<OS_MAX_THREADS + 1> OS_budgetHeld;
+static uint32_t OS_switchStamp; /* DWT->CYCCNT da ultima troca de contexto */
+#endif
+
+/* escalonamento O(1): cada tarefa periodica ocupa um slot de prioridade
+* fixo (0 = mais prioritaria), atribuido em OSPeriodicTask_start.
+* OS_readyPrio guarda as tarefas prontas ordenadas por prioridade num
+* bitmap de dois niveis, de modo que dois CLZ devolvem o slot vencedor.
+*/
+OSPeriodicTask *OS_prioTable[OS_MAX_THREADS]; /* tarefa periodica de cada slot */
+uint16_t OS_threadPrio[OS_MAX_THREADS + 1]; /* slot de cada thread */
+OSReadySet<OS_MAX_THREADS> OS_readyPrio; /* prontas ordenadas por prioridade */
+
+
+uint16_t OS_threadNum; /* number of threads started */
+/* tarefas periodicas registradas sem WCET: a analise nao enxerga a carga
+* delas, entao nao convivem com tarefas admitidas
+*/
+static uint16_t OS_undeclaredNum;
+uint16_t OS_currIdx; /* current thread index for the circular array */
+
+#if MIROS_CFG_SCHED_POLICY == MIROS_SCHED_EDF
+/* EDF: as tarefas prontas ficam num heap binario ordenado pelo deadline
+* absoluto (empates pelo slot rate-monotonic); a escolha e O(1) e
+* inserir/remover custa O(log n)
+*/
+OSPeriodicTask *OS_edfHeap[OS_MAX_THREADS];
+uint16_t OS_edfNum;
+
+/* a tem deadline antes de b */
+static inline bool OS_edfBefore(OSPeriodicTask const *a, OSPeriodicTask const *b) {
+	return (a->deadline < b->deadline)
+			|| (a->deadline == b->deadline && a->myPrio < b->myPrio);
+}
+
+static inline void OS_edfPlace(OSPeriodicTask *pt, uint16_t i) {
+	OS_edfHeap[i] = pt;
+	pt->heapIdx = i;
+}
+
+static void OS_edfSiftUp(uint16_t i) {
+	OSPeriodicTask *pt = OS_edfHeap[i];
+	while (i > 0U) {
+		uint16_t parent = (i - 1U) / 2U;
+		if (!OS_edfBefore(pt, OS_edfHeap[parent])) {
+			break;
+		}
+		OS_edfPlace(OS_edfHeap[parent], i);
+		i = parent;
+	}
+	OS_edfPlace(pt, i);
+}
 
+static void OS_edfSiftDown(uint16_t i) {
+	OSPeriodicTask *pt = OS_edfHeap[i];
+	for (;;) {
+		uint16_t child = 2U * i + 1U;
+		if (child >= OS_edfNum) {
+			break;
+		}
+		if (child + 1U < OS_edfNum
+			&& OS_edfBefore(OS_edfHeap[child + 1U], OS_edfHeap[child])) {
+			child++;
+		}
+		if (!OS_edfBefore(OS_edfHeap[child], pt)) {
+			break;
+		}
+		OS_edfPlace(OS_edfHeap[child], i);
+		i = child;
+	}
+	OS_edfPlace(pt, i);
+}
 
-uint32_t TempoCiclo=0;
-uint32_t TempoAtual=0;
+static void OS_edfInsert(OSPeriodicTask *pt) {
+	if (pt->heapIdx != OS_NO_INDEX) {
+		return;
+	}
+	OS_edfHeap[OS_edfNum] = pt;
+	OS_edfNum++;
+	OS_edfSiftUp(OS_edfNum - 1U);
+}
 
-OSThread *OS_thread[32 + 1]; /* array of threads started so far */
-uint32_t OS_readySet; /* bitmask of threads that are ready to run */
+static void OS_edfRemove(OSPeriodicTask *pt) {
+	uint16_t i = pt->heapIdx;
+	if (i == OS_NO_INDEX) {
+		return;
+	}
+	pt->heapIdx = OS_NO_INDEX;
+	OS_edfNum--;
+	if (i != OS_edfNum) {
+		OS_edfHeap[i] = OS_edfHeap[OS_edfNum];
+		OS_edfSiftUp(i);
+		OS_edfSiftDown(OS_edfHeap[i]->heapIdx);
+	}
+}
+#endif
 
+/* marca/desmarca a thread como pronta no OS_readySet e na estrutura
+* de prontas da politica de escalonamento
+*/
+static inline void OS_setReady(uint16_t threadIdx) {
+	OS_readySet.set(threadIdx);
+	if (OS_threadPrio[threadIdx] != OS_NO_INDEX) {
+#if MIROS_CFG_SCHED_POLICY == MIROS_SCHED_EDF
+		OS_edfInsert(OS_prioTable[OS_threadPrio[threadIdx]]);
+#else
+		OS_readyPrio.set(OS_threadPrio[threadIdx]);
+#endif
+	}
+}
+static inline void OS_clearReady(uint16_t threadIdx) {
+	OS_readySet.clear(threadIdx);
+	if (OS_threadPrio[threadIdx] != OS_NO_INDEX) {
+#if MIROS_CFG_SCHED_POLICY == MIROS_SCHED_EDF
+		OS_edfRemove(OS_prioTable[OS_threadPrio[threadIdx]]);
+#else
+		OS_readyPrio.clear(OS_threadPrio[threadIdx]);
+#endif
+	}
+}
 
-uint8_t OS_threadNum; /* number of threads started */
-uint8_t OS_currIdx; /* current thread index for the circular array */
+/* tarefa periodica pronta de maior prioridade, ou 0 se nenhuma */
+static inline OSPeriodicTask *OS_readyTop(void) {
+#if MIROS_CFG_SCHED_POLICY == MIROS_SCHED_EDF
+	return (OS_edfNum != 0U) ? OS_edfHeap[0] : (OSPeriodicTask *)0;
+#else
+	/* slot mais prioritario pronto em tempo constante */
+	return !OS_readyPrio.empty()
+			? OS_prioTable[OS_readyPrio.first()] : (OSPeriodicTask *)0;
+#endif
+}
 
 
 bool AperiodicServerStarted = false;
 
+OSSporadicServer *OS_server; /* servidor esporadico, se houver */
+static void OS_serverActivate(OSSporadicServer *me);
+
+/* o slot pertence ao servidor esporadico, que nao tem liberacoes periodicas */
+static inline bool OS_isServer(OSPeriodicTask const *pt) {
+	return OS_server != (OSSporadicServer *)0 && pt == &OS_server->task;
+}
+
 rtos :: MySemaphore preemptionAllowed;
 
+/* teto do sistema: slot do mutex travado mais restritivo e seu dono */
+static uint16_t OS_ceilPrio = OS_NO_INDEX;
+static OSPeriodicTask *OS_ceilOwner;
+
 
 void desativarPreempcao(){
 	preemptionAllowed.tryLock();
@@ -96,14 +267,21 @@ void reativarPreempcao(){
 OSThread idleThread;
 
 void AperiodicServerStart(){
+	__disable_irq();
 	AperiodicServerStarted = true;
+	if (OS_server != (OSSporadicServer *)0) {
+		OS_serverActivate(OS_server);
+	}
+	__enable_irq();
 }
 void AperiodicServerStop(){
 	AperiodicServerStarted = false;
 }
 void main_idleThread() {
     while (1) {
-    	while(OS_AperiodicTaskNum>0 && AperiodicServerStarted)
+    	/* com servidor esporadico as aperiodicas sao so dele */
+    	while(OS_jobsPending() && AperiodicServerStarted
+    	      && OS_server == (OSSporadicServer *)0)
     	{
     		osAperiodicWrapper();
     	}
@@ -114,8 +292,7 @@ void main_idleThread() {
 
 
 void OS_init(void *stkSto, uint32_t stkSize) {
-    /* set the PendSV interrupt priority to the lowest level 0xFF */
-    *(uint32_t volatile *)0xE000ED20 |= (0xFFU << 16);
+    OS_portInit();
 
     /* start idleThread thread */
     OSThread_start(&idleThread,
@@ -123,67 +300,657 @@ void OS_init(void *stkSto, uint32_t stkSize) {
                    stkSto, stkSize);
 }
 
+/* passa os jobs recem-chegados do anel para o heap e executa o de menor
+* deadline
+*/
 void osAperiodicWrapper() {
-		OSAperiodicTasks[0]->myTask();
-		for(uint8_t i =0; i<OS_AperiodicTaskNum-1; i++){
-			OSAperiodicTasks[i] = OSAperiodicTasks[i+1];
-			 OSAperiodicTasks[i+1] = 0x0;
+	OSAperiodicTask *job;
+	while (!OS_jobHeap.full() && OS_aperiodicQueue.pop(job)) {
+		OS_jobHeap.push(job);
+	}
+	job = OS_jobHeap.pop();
+	if (job != (OSAperiodicTask *)0) {
+		OS_jobRunning = true;
+		job->myJob(job->arg);
+		OS_jobRunning = false;
+	}
+}
+
+
+/* ativa o servidor se houver trabalho (jobs na fila ou um job suspenso
+* no meio) e budget; interrupcoes DESABILITADAS
+*/
+static void OS_serverActivate(OSSporadicServer *me) {
+	if (me->active || me->budget == 0U || !(OS_jobsPending() || OS_jobRunning)
+		|| !AperiodicServerStarted) {
+		return;
+	}
+	me->active = true;
+	me->activeSince = OS_time;
+	me->consumed = 0U;
+	me->task.deadline = OS_time + me->task.Period; /* ordem em EDF */
+	OS_setReady(me->task.myThreadIndex);
+}
+
+/* fim da ativacao (fila vazia ou budget esgotado): agenda a devolucao do
+* que foi consumido para activeSince + Ts; interrupcoes DESABILITADAS
+*/
+static void OS_serverDeactivate(OSSporadicServer *me) {
+	me->active = false;
+	OS_clearReady(me->task.myThreadIndex);
+	if (me->consumed == 0U) {
+		return;
+	}
+
+	uint64_t at = me->activeSince + me->task.Period;
+	uint8_t tail = (me->replenishHead + me->replenishNum - 1U) % MIROS_CFG_SS_REPLENISH_LEN;
+	if (me->replenishNum != 0U
+		&& (me->replenish[tail].at == at || me->replenishNum == MIROS_CFG_SS_REPLENISH_LEN)) {
+		/* mesmo instante, ou fila cheia: adia esta parte para a ultima */
+		me->replenish[tail].amount += me->consumed;
+		if (at > me->replenish[tail].at) {
+			me->replenish[tail].at = at;
 		}
-		OS_AperiodicTaskNum--;
+	}
+	else {
+		tail = (me->replenishHead + me->replenishNum) % MIROS_CFG_SS_REPLENISH_LEN;
+		me->replenish[tail].at = at;
+		me->replenish[tail].amount = me->consumed;
+		me->replenishNum++;
+	}
+	me->consumed = 0U;
+
+	if (!me->replenishTimer.armed) {
+		OSTimerQueue_arm(&OS_timers, &me->replenishTimer,
+		                 (uint32_t)(me->replenish[me->replenishHead].at - OS_time));
+	}
 }
 
+/* reposicao vencida: devolve o budget e rearma para a proxima */
+static void OS_serverReplenish(void *arg) {
+	OSSporadicServer *me = (OSSporadicServer *)arg;
+	OSReplenishment *r = &me->replenish[me->replenishHead];
 
-void OSAperiodicTask_start(OSAperiodicTask *me,
+	me->budget += r->amount;
+	if (me->budget > me->capacity) {
+		me->budget = me->capacity;
+	}
+	me->replenishHead = (me->replenishHead + 1U) % MIROS_CFG_SS_REPLENISH_LEN;
+	me->replenishNum--;
+
+	if (me->replenishNum != 0U) {
+		r = &me->replenish[me->replenishHead];
+		uint64_t wait = (r->at > OS_time) ? (r->at - OS_time) : 1U;
+		OSTimerQueue_arm(&OS_timers, &me->replenishTimer, (uint32_t)wait);
+	}
+	OS_serverActivate(me);
+}
+
+/* consumo do tick que acabou de passar, se o servidor estava executando */
+static inline void OS_serverTick(void) {
+	OSSporadicServer *me = OS_server;
+	if (me == (OSSporadicServer *)0 || !me->active
+		|| OS_curr != &me->task.my_Thread) {
+		return;
+	}
+	me->budget--;
+	me->consumed++;
+	if (me->budget == 0U) {
+		/* sem budget: a thread fica suspensa ate a proxima reposicao,
+		* mesmo no meio de um job
+		*/
+		OS_serverDeactivate(me);
+	}
+}
+
+/* corpo da thread do servidor */
+static void OS_serverThread() {
+	OSSporadicServer *me = OS_server;
+	while (1) {
+		osAperiodicWrapper();
+		__disable_irq();
+		if (!OS_jobsPending() && me->active) {
+			OS_serverDeactivate(me);
+		}
+		OS_sched();
+		__enable_irq();
+	}
+}
+
+/* adapta o handler sem argumento ao formato com carga */
+static void OS_jobCallTask(void *arg) {
+	((OSAperiodicTask *)arg)->myTask();
+}
+
+static bool OS_jobPost(OSAperiodicTask *me);
+
+bool OSAperiodicTask_start(OSAperiodicTask *me,
     OSThreadHandler threadHandler){
-	__disable_irq();
 	me->myTask = threadHandler;
-	OSAperiodicTasks[OS_AperiodicTaskNum] = me;
-	OS_AperiodicTaskNum++;
-	__enable_irq();
+	me->myJob = &OS_jobCallTask;
+	me->arg = me;
+	me->deadline = OS_NO_DEADLINE;
+	return OS_jobPost(me);
 }
 
+bool OSAperiodicTask_start(OSAperiodicTask *me,
+    OSJobHandler jobHandler, void *arg, uint32_t deadline){
+	me->myTask = (OSThreadHandler)0;
+	me->myJob = jobHandler;
+	me->arg = arg;
+	me->deadline = (deadline == 0U) ? OS_NO_DEADLINE : OS_getTime() + deadline;
+	return OS_jobPost(me);
+}
 
+static bool OS_jobPost(OSAperiodicTask *me) {
+	if (!OS_aperiodicQueue.push(me)) {
+		return false; /* fila cheia */
+	}
+	/* so acordar o servidor mexe no estado do kernel; PRIMASK e
+	* preservado para funcionar tambem de dentro de uma secao critica
+	*/
+	if (OS_server != (OSSporadicServer *)0) {
+		uint32_t primask = __get_PRIMASK();
+		__disable_irq();
+		OS_serverActivate(OS_server);
+		OS_sched();
+		__set_PRIMASK(primask);
+	}
+	return true;
+}
 
 
-void OS_sched(void) {
 
-	 uint32_t minPeriod = 0xFFFFFFFFU;
 
-	 uint8_t periodicIndex= 0u;
+void OS_sched(void) {
 
-	 if (OS_readySet == 0U) {
+	 OSPeriodicTask *pt = OS_readyTop();
+	 /* com um mutex travado so preempta quem esta acima do teto */
+	 if (OS_ceilOwner != (OSPeriodicTask *)0 && pt != OS_ceilOwner
+		 && (pt == (OSPeriodicTask *)0 || pt->myPrio >= OS_ceilPrio)) {
+		 pt = OS_ceilOwner;
+	 }
+	 if (pt == (OSPeriodicTask *)0) {
 	        OS_currIdx = 0U; // idle
 	 }
-
 	 else {
-		for (uint8_t n = 0; n < OS_periodicTaskNum; n++) {
-			// Mapear OSPeriodicTasks[n] para OS_thread[n + 1]
-			uint8_t threadIdx = OSPeriodicTasks[n]->myThreadIndex;
-			if ((OS_readySet & (1U << (threadIdx - 1U)))) {
-				OSPeriodicTask *pt = OSPeriodicTasks[n]; // Usar índice correto
-				if (pt->Period < minPeriod) {
-					minPeriod = pt->Period;
-					OS_currIdx = threadIdx;
-					periodicIndex = n;
-				}
-			}
-		}
-	}
-
-	 if(OS_currIdx!=0){
-		OSPeriodic_curr =  OSPeriodicTasks[periodicIndex];
+		OS_currIdx = pt->myThreadIndex;
+		OSPeriodic_curr = pt;
 	 }
 
      OS_next = OS_thread[OS_currIdx];
 
     /* trigger PendSV, if needed */
     if(OS_next != OS_curr && preemptionAllowed.isAvailable() ){
-    	*(uint32_t volatile *)0xE000ED04 = (1U << 28);
+    	OS_portPendSwitch();
     }
 
 }
 
+/* chamado pelo PendSV depois de salvar o contexto de OS_curr, com
+* interrupcoes desabilitadas
+*/
+void OS_switchHook(void) {
+	OSThread *t = OS_curr;
+#if MIROS_CFG_BUDGET
+	/* cobra da tarefa que sai o tempo desde a ultima troca */
+	uint32_t now = DWT->CYCCNT;
+	uint16_t slot = OS_threadPrio[t->index];
+	if (slot != OS_NO_INDEX) {
+		OS_prioTable[slot]->execCycles += now - OS_switchStamp;
+	}
+	OS_switchStamp = now;
+#endif
+#if MIROS_CFG_STACK_CHECK
+	/* a palavra do fundo so e escrita quando a pilha ja transbordou (de
+	* uma ISR aninhada, tambem): melhor parar do que corromper a vizinha
+	*/
+	if (*(uint32_t const *)t->stkBase != OS_STACK_PAINT) {
+		Q_ERROR();
+	}
+#endif
+	OS_TRACE(OS_EV_SWITCH, OS_next->index);
+	if (t->restart) {
+		t->restart = false;
+		OS_portThreadRestart(t);
+	}
+}
+
+/* descarta o job atual: sai de qualquer espera e a thread recomeca do
+* inicio do wrapper; interrupcoes DESABILITADAS
+*/
+static void OS_jobAbort(OSPeriodicTask *pt) {
+	OSThread *t = &pt->my_Thread;
+	if (t->waitList != (OSWaitList *)0) {
+		t->waitList->clear(t->index);
+		t->waitList = (OSWaitList *)0;
+	}
+	OSTimerQueue_disarm(&OS_timers, &t->timeout);
+	OS_clearReady(t->index); /* o novo job entra com o deadline novo */
+	pt->lateJobs = 0U;
+	pt->lateRun = false;
+	pt->missCounted = false;
+	if (t == OS_curr) {
+		/* contexto ainda nao salvo: o PendSV salva e o hook reescreve */
+		t->restart = true;
+		OS_portPendSwitch();
+	}
+	else {
+		OS_portThreadRestart(t);
+	}
+}
+
+/* conta a perda e devolve a politica efetiva; interrupcoes DESABILITADAS */
+static uint8_t OS_missPolicy(OSPeriodicTask *pt, bool overrun) {
+	pt->misses++;
+	OS_TRACE(OS_EV_MISS, pt->myThreadIndex);
+	uint8_t policy = pt->missPolicy;
+	if (policy == OS_MISS_HANDLER) {
+		policy = pt->missHandler(pt, overrun);
+	}
+	if (policy == OS_MISS_ASSERT) {
+		Q_ERROR(); // Deadline miss
+	}
+	return policy;
+}
+
+/* liberacao de uma tarefa com o job anterior ainda ativo ou com pulo
+* pendente; true se o novo job deve ser liberado agora
+*/
+static bool OS_releaseAdmit(OSPeriodicTask *pt) {
+	uint16_t idx = pt->myThreadIndex;
+#if MIROS_CFG_BUDGET
+	if (OS_budgetHeld.test(idx)) {
+		/* orcamento renovado: o job suspenso volta e a liberacao conta
+		* como perda do job anterior
+		*/
+		OS_budgetHeld.clear(idx);
+		pt->execCycles = 0U;
+		pt->overBudget = false;
+		OS_setReady(idx);
+	}
+#endif
+	if (OS_skipNext.test(idx)) {
+		OS_skipNext.clear(idx);
+		pt->skipped++;
+		return false;
+	}
+	if (!OS_jobActive.test(idx)) {
+		return true;
+	}
+	/* o fim atrasado deste job nao conta de novo (nem pula mais um) */
+	pt->missCounted = true;
+	switch (OS_missPolicy(pt, true)) {
+	case OS_MISS_ABORT:
+		if (pt->mutexHeld == 0U && preemptionAllowed.isAvailable()) {
+			OS_jobAbort(pt);
+			pt->aborted++;
+			return true;
+		}
+		/* com mutex travado (ou sem preempcao) abortar quebraria o
+		* protocolo: roda atrasado
+		*/
+		[[fallthrough]];
+	case OS_MISS_RUN_LATE:
+		if (pt->lateJobs < OS_MISS_MAX_LATE) {
+			pt->lateJobs++;
+			return false;
+		}
+		[[fallthrough]];
+	default: /* OS_MISS_SKIP */
+		pt->skipped++;
+		return false;
+	}
+}
+
+#if MIROS_CFG_STATS
+/* conta uma amostra no balde log2; ~15 ciclos com CLZ */
+static inline void OS_histAdd(OSHist *h, uint32_t cycles) {
+	uint32_t k = 32U - __CLZ(cycles | 1U); /* numero de bits, 1..32 */
+	k = (k > 8U) ? (k - 8U) : 0U;
+	if (k >= OS_HIST_BUCKETS) {
+		k = OS_HIST_BUCKETS - 1U;
+	}
+	if (h->bucket[k] != 0xFFFFU) {
+		h->bucket[k]++;
+	}
+	h->count++;
+	if (cycles > h->max) {
+		h->max = cycles;
+	}
+}
+
+void OS_statsSnapshot(OSPeriodicTask const *me, OSTaskStats *out) {
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	*out = me->stats;
+	__set_PRIMASK(primask);
+}
+
+void OS_statsReset(OSPeriodicTask *me) {
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	me->stats = OSTaskStats{};
+	__set_PRIMASK(primask);
+}
+
+static void OS_itmPuts(char const *s) {
+	while (*s != '\0') {
+		ITM_SendChar((uint32_t)*s++);
+	}
+}
+
+static void OS_itmPutu(uint32_t v) {
+	char buf[11];
+	uint8_t n = 0U;
+	do {
+		buf[n++] = (char)('0' + v % 10U);
+		v /= 10U;
+	} while (v != 0U);
+	while (n != 0U) {
+		ITM_SendChar((uint32_t)buf[--n]);
+	}
+}
+
+static void OS_histPut(char const *name, OSHist const *h) {
+	OS_itmPuts(name);
+	OS_itmPuts(" n=");
+	OS_itmPutu(h->count);
+	OS_itmPuts(" max=");
+	OS_itmPutu(h->max);
+	OS_itmPuts(" h=");
+	for (uint8_t k = 0U; k < OS_HIST_BUCKETS; k++) {
+		if (k != 0U) {
+			ITM_SendChar(',');
+		}
+		OS_itmPutu(h->bucket[k]);
+	}
+	ITM_SendChar('\n');
+}
+
+/* uma linha por histograma:
+* "T<i> P<periodo> exec n=<n> max=<ciclos> h=<b0>,...,<b23>"
+* so a copia e feita com as interrupcoes desabilitadas
+*/
+void OS_statsDump(void) {
+	OSTaskStats snap;
+	for (uint16_t i = 0U; i < OS_periodicTaskNum; i++) {
+		OSPeriodicTask const *pt = OSPeriodicTasks[i];
+		OS_statsSnapshot(pt, &snap);
+		OSHist const *h[3] = { &snap.exec, &snap.response, &snap.jitter };
+		char const *name[3] = { " exec", " resp", " jitter" };
+		for (uint8_t m = 0U; m < 3U; m++) {
+			ITM_SendChar('T');
+			OS_itmPutu(i);
+			OS_itmPuts(" P");
+			OS_itmPutu(pt->Period);
+			OS_histPut(name[m], h[m]);
+		}
+	}
+}
+#endif
+
+#if MIROS_CFG_TRACE
+uint32_t OS_traceDropped;
+
+void OS_traceInit(void) {
+	ITM->LAR = 0xC5ACCE55U; /* destrava os registradores do ITM */
+	/* portas 1..OS_EV_BUDGET; a porta 0 continua com o texto */
+	ITM->TER |= ((1UL << (OS_EV_BUDGET + 1U)) - 1U) & ~1UL;
+}
+#endif
+
+#if MIROS_CFG_BUDGET
+/* o job atual passou do orcamento; interrupcoes DESABILITADAS */
+static void OS_budgetOverrun(OSPeriodicTask *pt) {
+	uint16_t idx = pt->myThreadIndex;
+	pt->overBudget = true;
+	pt->budgetOverruns++;
+	OS_TRACE(OS_EV_BUDGET, idx);
+	if (pt->mutexHeld != 0U) {
+		return; /* suspenso, o dono do teto ainda seria escolhido */
+	}
+	if (pt->budgetAction == OS_BUDGET_ABORT && preemptionAllowed.isAvailable()) {
+		OS_jobAbort(pt);
+		OS_jobActive.clear(idx); /* a thread espera a proxima liberacao */
+		pt->aborted++;
+	}
+	else if (pt->budgetAction == OS_BUDGET_SUSPEND) {
+		OS_clearReady(idx);
+		OS_budgetHeld.set(idx);
+	}
+}
+
+/* verifica o orcamento da tarefa em execucao; o tick e o que garante a
+* verificacao mesmo se ela nunca ceder a CPU
+*/
+static inline void OS_budgetTick(void) {
+	OSThread *t = OS_curr;
+	if (t == (OSThread *)0 || OS_threadPrio[t->index] == OS_NO_INDEX) {
+		return;
+	}
+	OSPeriodicTask *pt = OS_prioTable[OS_threadPrio[t->index]];
+	if (pt->budgetCycles == 0U || pt->overBudget || t->restart
+		|| !OS_jobActive.test(t->index)) {
+		return;
+	}
+	if (pt->execCycles + (DWT->CYCCNT - OS_switchStamp) > pt->budgetCycles) {
+		OS_budgetOverrun(pt);
+	}
+}
+#endif
+
+void OSPeriodicTask_setBudgetAction(OSPeriodicTask *me, uint8_t action) {
+	Q_REQUIRE(action <= OS_BUDGET_ABORT);
+	__disable_irq();
+	me->budgetAction = action;
+	__enable_irq();
+}
+
+void OSPeriodicTask_setMissPolicy(OSPeriodicTask *me, uint8_t policy,
+    OSMissHandler handler) {
+	Q_REQUIRE(policy <= OS_MISS_HANDLER
+			  && (policy != OS_MISS_HANDLER || handler != (OSMissHandler)0));
+	__disable_irq();
+	me->missPolicy = policy;
+	me->missHandler = handler;
+	__enable_irq();
+}
+
+#if MIROS_CFG_RELEASE_TABLE
+/* evento de liberacao: quando a fase do hiperperiodo chega em tick as
+* tarefas das mascaras ficam prontas de uma vez
+*/
+typedef struct {
+	uint32_t tick; /* instante dentro do hiperperiodo */
+	OSReadySet<OS_MAX_THREADS + 1> readyMask; /* a unir em OS_readySet */
+	OSReadySet<OS_MAX_THREADS> prioMask; /* a unir em OS_readyPrio */
+} OSReleaseEvent;
+
+static OSReleaseEvent OS_releaseTable[MIROS_CFG_RELEASE_TABLE_LEN];
+static uint16_t OS_releaseNum;
+static uint16_t OS_releaseCursor; /* proximo evento */
+static uint32_t OS_hyperPeriod; /* mmc dos periodos */
+static uint32_t OS_hyperPhase; /* OS_time modulo OS_hyperPeriod */
+static bool OS_releaseTableOn;
+
+/* monta a tabela do hiperperiodo; chamar com interrupcoes DESABILITADAS,
+* depois de registrar todas as tarefas periodicas
+*/
+static void OS_buildReleaseTable(void) {
+	/* mmc em 64 bits: periodos primos entre si estouram 32 bits rapido */
+	uint64_t hyper = 1U;
+	for (uint16_t n = 0U; n < OS_periodicTaskNum; n++) {
+		if (OS_isServer(OSPeriodicTasks[n])) {
+			continue;
+		}
+		uint32_t period = OSPeriodicTasks[n]->Period;
+		hyper = (hyper / gcd(period, (uint32_t)(hyper % period))) * period;
+		if (hyper > 0xFFFFFFFFU) {
+			return; /* hiperperiodo grande demais: fica na fila de timeouts */
+		}
+	}
+
+	uint16_t num = 0U;
+	uint32_t t = 0U;
+	while (t < hyper) {
+		if (num == Q_DIM(OS_releaseTable)) {
+			return; /* nao cabe: continua com a fila de timeouts */
+		}
+		OSReleaseEvent &e = OS_releaseTable[num];
+		e.tick = t;
+		e.readyMask.reset();
+		e.prioMask.reset();
+		uint32_t next = (uint32_t)hyper;
+		for (uint16_t n = 0U; n < OS_periodicTaskNum; n++) {
+			OSPeriodicTask const *pt = OSPeriodicTasks[n];
+			if (OS_isServer(pt)) {
+				continue;
+			}
+			if (t >= pt->Offset && (t - pt->Offset) % pt->Period == 0U) {
+				e.readyMask.set(pt->myThreadIndex);
+				e.prioMask.set(pt->myPrio);
+			}
+			uint32_t nt = (t < pt->Offset) ? pt->Offset
+					: ((t - pt->Offset) / pt->Period + 1U) * pt->Period + pt->Offset;
+			if (nt < next) {
+				next = nt;
+			}
+		}
+		num++;
+		t = next;
+	}
+
+	/* o evento 0 ja foi consumido: as tarefas sem offset nascem prontas */
+	OS_hyperPeriod = (uint32_t)hyper;
+	OS_hyperPhase = 0U;
+	OS_releaseNum = num;
+	OS_releaseCursor = (num > 1U) ? 1U : 0U;
+	for (uint16_t n = 0U; n < OS_periodicTaskNum; n++) {
+		OSTimerQueue_disarm(&OS_timers, &OSPeriodicTasks[n]->release);
+	}
+	OS_releaseTableOn = true;
+}
+
+/* avanca a fase e processa as liberacoes do tick com uma consulta a tabela */
+static inline void OS_releaseTick(void) {
+	OS_hyperPhase++;
+	if (OS_hyperPhase == OS_hyperPeriod) {
+		OS_hyperPhase = 0U;
+	}
+	OSReleaseEvent const *e = &OS_releaseTable[OS_releaseCursor];
+	if (e->tick != OS_hyperPhase) {
+		return;
+	}
+	OSReadySet<OS_MAX_THREADS + 1> rel = e->readyMask;
+	OSReadySet<OS_MAX_THREADS> relPrio = e->prioMask;
+	/* job anterior ainda ativo ou pulo pendente: politica de cada tarefa */
+	if (OS_jobActive.intersects(rel) || OS_skipNext.intersects(rel)) {
+		OSReadySet<OS_MAX_THREADS + 1> hit = OS_jobActive;
+		hit.merge(OS_skipNext);
+		hit.mask(rel);
+		while (!hit.empty()) {
+			uint16_t idx = hit.first();
+			OSPeriodicTask *pt = OS_prioTable[OS_threadPrio[idx]];
+			hit.clear(idx);
+			if (!OS_releaseAdmit(pt)) {
+				rel.clear(idx);
+				relPrio.clear(pt->myPrio);
+			}
+		}
+	}
+	OS_jobActive.merge(rel);
+	OS_readySet.merge(rel);
+#if MIROS_CFG_STATS || MIROS_CFG_TRACE
+#if MIROS_CFG_STATS
+	uint32_t stamp = DWT->CYCCNT;
+#endif
+	OSReadySet<OS_MAX_THREADS> s = relPrio;
+	while (!s.empty()) {
+		uint16_t slot = s.first();
+#if MIROS_CFG_STATS
+		OS_prioTable[slot]->releaseStamp = stamp;
+#endif
+		OS_TRACE(OS_EV_RELEASE, OS_prioTable[slot]->myThreadIndex);
+		s.clear(slot);
+	}
+#endif
+	/* deadline e proxima liberacao ficam na tarefa como na fila de
+	* timeouts; uma liberacao recusada pela politica so avanca nextRelease
+	*/
+	OSReadySet<OS_MAX_THREADS> m = e->prioMask;
+	while (!m.empty()) {
+		uint16_t slot = m.first();
+		OSPeriodicTask *pt = OS_prioTable[slot];
+		pt->nextRelease = OS_time + pt->Period;
+		if (relPrio.test(slot)) {
+			pt->deadline = OS_time + pt->Deadline;
+#if MIROS_CFG_SCHED_POLICY == MIROS_SCHED_EDF
+			OS_edfInsert(pt);
+#endif
+		}
+		m.clear(slot);
+	}
+#if MIROS_CFG_SCHED_POLICY != MIROS_SCHED_EDF
+	OS_readyPrio.merge(relPrio);
+#endif
+	OS_releaseCursor++;
+	if (OS_releaseCursor == OS_releaseNum) {
+		OS_releaseCursor = 0U;
+	}
+}
+
+/* ticks ate o proximo evento da tabela */
+static inline uint32_t OS_releaseTicksLeft(void) {
+	uint32_t tick = OS_releaseTable[OS_releaseCursor].tick;
+	return (tick > OS_hyperPhase) ? (tick - OS_hyperPhase)
+	                              : (tick + OS_hyperPeriod - OS_hyperPhase);
+}
+#endif
+
+#if MIROS_CFG_STACK_CHECK
+uint32_t OS_stackUsed(uint16_t threadIdx) {
+	Q_REQUIRE(threadIdx < OS_threadNum);
+	OSThread const *t = OS_thread[threadIdx];
+	uint32_t const *p = (uint32_t const *)t->stkBase;
+	while ((void const *)p < t->stkTop && *p == OS_STACK_PAINT) {
+		p++;
+	}
+	return (uint32_t)((uint8_t const *)t->stkTop - (uint8_t const *)p);
+}
+#endif
+
+uint64_t OS_getTime(void) {
+	uint32_t primask = __get_PRIMASK(); /* chamada tambem por ISRs */
+	__disable_irq();
+	uint64_t now = OS_time;
+	__set_PRIMASK(primask);
+	return now;
+}
+
 void OS_run(void) {
+#if MIROS_CFG_RELEASE_TABLE
+    __disable_irq();
+    OS_buildReleaseTable();
+    __enable_irq();
+#endif
+#if MIROS_CFG_BUDGET || MIROS_CFG_TRACE
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+#if MIROS_CFG_BUDGET
+    OS_switchStamp = DWT->CYCCNT;
+#endif
+#if MIROS_CFG_TRACE
+    OS_traceInit();
+#endif
+#if MIROS_CFG_STATS
+    /* jobs liberados antes do DWT ligar contam a partir daqui */
+    for (uint16_t i = 0U; i < OS_periodicTaskNum; i++) {
+        OSPeriodicTasks[i]->releaseStamp = OS_switchStamp;
+    }
+#endif
+
     /* callback to configure and start interrupts */
     OS_onStartup();
 
@@ -191,301 +958,909 @@ void OS_run(void) {
     OS_sched();
     __enable_irq();
 
+#ifdef MIROS_PORT_POSIX
+    return; /* a simulacao terminou (OS_portStopAt) */
+#endif
     /* the following code should never execute */
     Q_ERROR();
 }
 
 
-void checkDeadline(uint8_t n){
-	  OSPeriodicTask *pt = OSPeriodicTasks[n];
-	        uint32_t deadline = pt->lastAtivation + pt->Period;
-	        if (deadline <= TempoCiclo) {
-				if (TempoAtual >= deadline) {
-					if (TempoAtual > deadline) {// && (TempoAtual != TempoCiclo && pt->lastAtivation  != 0)
-						Q_ERROR(); // Deadline miss
+void OSTimer_init(OSTimer *me, OSTimerHandler handler, void *arg) {
+	me->next = (OSTimer *)0;
+	me->delta = 0U;
+	me->handler = handler;
+	me->arg = arg;
+	me->armed = false;
+}
 
-					}
-					else{
-						if((OS_readySet & (1U << (pt->myThreadIndex - 1U)))){
-							Q_ERROR(); // Deadline miss
-						}
+void OSTimerQueue_arm(OSTimerQueue *me, OSTimer *t, uint32_t ticks) {
+	Q_REQUIRE(ticks != 0U && !t->armed);
 
-						//marca tarefa como pronta
-						OS_readySet |= (1U <<  (pt->myThreadIndex - 1U));
+	/* anda pela lista descontando os deltas ate achar a posicao;
+	* nos que expiram no mesmo tick ficam na ordem de insercao
+	*/
+	OSTimer **link = &me->head;
+	while (*link != (OSTimer *)0 && (*link)->delta <= ticks) {
+		ticks -= (*link)->delta;
+		link = &(*link)->next;
+	}
+	t->delta = ticks;
+	t->next = *link;
+	if (t->next != (OSTimer *)0) {
+		t->next->delta -= ticks;
+	}
+	*link = t;
+	t->armed = true;
+}
 
-							 pt->lastAtivation = TempoAtual;
+void OSTimerQueue_disarm(OSTimerQueue *me, OSTimer *t) {
+	if (!t->armed) {
+		return;
+	}
+	OSTimer **link = &me->head;
+	while (*link != t) {
+		link = &(*link)->next;
+	}
+	if (t->next != (OSTimer *)0) {
+		t->next->delta += t->delta;
+	}
+	*link = t->next;
+	t->next = (OSTimer *)0;
+	t->armed = false;
+}
 
-					}
-				}
-			}
-	                // Lógica para deadlines no próximo ciclo
-			else {
-				uint32_t adjustedDeadline = deadline - TempoCiclo;
-				if (TempoAtual >= adjustedDeadline) {
-					if (TempoAtual > adjustedDeadline) {
-						Q_ERROR(); // Deadline miss
-
-					}
-					else{
-						if((OS_readySet & (1U << ( pt->myThreadIndex - 1U)))){
-							Q_ERROR(); // Deadline miss
-
-						}
-						OS_readySet |= (1U << ( pt->myThreadIndex - 1U));
-						pt->lastAtivation = TempoAtual;
-					}
-				}
-			}
+void OSTimerQueue_tick(OSTimerQueue *me) {
+	OSTimer *t = me->head;
+	if (t == (OSTimer *)0) {
+		return;
+	}
+	t->delta--;
+	/* o handler pode rearmar o proprio no; como ticks != 0 ele volta
+	* para depois dos que ainda estao com delta 0
+	*/
+	while ((t = me->head) != (OSTimer *)0 && t->delta == 0U) {
+		me->head = t->next;
+		t->next = (OSTimer *)0;
+		t->armed = false;
+		t->handler(t->arg);
+	}
 }
 
-void OS_tick(void) {
-	uint8_t n = 0;
-	TempoAtual++;
-	if(TempoAtual>TempoCiclo){
-		TempoAtual = 0;
-	}
-	for(n=1U;n<OS_threadNum; n++){ 				/* cycle through every thread but the idle */
-		if(OS_thread[n]->timeout != 0U){
-			OS_thread[n]->timeout--;			/* decrease the timeout */
-			if(OS_thread[n]->timeout == 0U){
-				OS_readySet |= (1U << (n-1U));	/* if the thread is ready mask the corresponding bit */
-			}
+/* fim do OS_delay ou timeout de uma espera: a thread volta a ficar pronta */
+static void OS_threadWakeup(void *arg) {
+	OSThread *t = (OSThread *)arg;
+	if (t->waitList != (OSWaitList *)0) {
+		t->waitList->clear(t->index);
+		t->waitList = (OSWaitList *)0;
+		t->timedOut = true;
+	}
+	OS_setReady(t->index);
+}
+
+/* liberacao periodica disparada pela fila de timeouts */
+static void OS_periodicRelease(void *arg) {
+	OSPeriodicTask *pt = (OSPeriodicTask *)arg;
+
+	/* job anterior ainda nao terminou na proxima liberacao */
+	if (OS_jobActive.test(pt->myThreadIndex) || OS_skipNext.test(pt->myThreadIndex)) {
+		if (!OS_releaseAdmit(pt)) {
+			pt->nextRelease += pt->Period;
+			OSTimerQueue_arm(&OS_timers, &pt->release, pt->Period);
+			return;
 		}
 	}
-	if (TempoCiclo == 0) return;
-    for (uint8_t n = 0; n < OS_periodicTaskNum; n++) {
-    	checkDeadline(n);
+
+	//marca tarefa como pronta
+#if MIROS_CFG_STATS
+	pt->releaseStamp = DWT->CYCCNT;
+#endif
+	OS_TRACE(OS_EV_RELEASE, pt->myThreadIndex);
+	pt->deadline = pt->nextRelease + pt->Deadline;
+	pt->nextRelease += pt->Period;
+	OS_jobActive.set(pt->myThreadIndex);
+	OS_setReady(pt->myThreadIndex);
+
+	OSTimerQueue_arm(&OS_timers, &pt->release, pt->Period);
+}
+
+void OS_tick(void) {
+	OS_time = OS_time + 1U; /* volatile: leitura e escrita explicitas */
+#if MIROS_CFG_BUDGET
+	OS_budgetTick();
+#endif
+#if MIROS_CFG_RELEASE_TABLE
+	if (OS_releaseTableOn) {
+		OS_releaseTick();
 	}
+#endif
+	/* so os timeouts e liberacoes que vencem neste tick sao processados */
+	OSTimerQueue_tick(&OS_timers);
+	/* depois da fila: a reposicao armada aqui ao esgotar o budget conta
+	* a partir deste tick e nao e descontada ja neste
+	*/
+	OS_serverTick();
  }
 
+void OS_tickSkip(uint32_t ticks) {
+	if (ticks == 0U) {
+		return;
+	}
+	/* nenhum no pode vencer nos ticks pulados */
+	Q_REQUIRE(OS_timers.head == (OSTimer *)0 || OS_timers.head->delta > ticks);
+#if MIROS_CFG_RELEASE_TABLE
+	Q_REQUIRE(!OS_releaseTableOn || OS_releaseTicksLeft() > ticks);
+#endif
+
+	OS_time = OS_time + ticks;
+#if MIROS_CFG_RELEASE_TABLE
+	if (OS_releaseTableOn) {
+		OS_hyperPhase += ticks; /* nao passa do proximo evento */
+	}
+#endif
+	if (OS_timers.head != (OSTimer *)0) {
+		OS_timers.head->delta -= ticks;
+	}
+}
+
 
 
 void OS_delay(uint32_t ticks) {
-    __asm volatile ("cpsid i");
+    __disable_irq();
 
     /* never call OS_delay from the idleThread */
     Q_REQUIRE(OS_curr != OS_thread[0]);
 
-    OS_curr->timeout = ticks;
-    OS_readySet &= ~(1U << (OS_currIdx - 1U));
+    OSTimerQueue_arm(&OS_timers, &OS_curr->timeout, ticks);
+    OS_clearReady(OS_currIdx);
     OS_sched();
-    __asm volatile ("cpsie i");
+    __enable_irq();
  }
 
 
+/* a thread a deve ser acordada antes de b? Threads sem slot por ultimo */
+static bool OS_threadBefore(uint16_t a, uint16_t b) {
+	uint16_t pa = OS_threadPrio[a];
+	uint16_t pb = OS_threadPrio[b];
+	if (pa == OS_NO_INDEX || pb == OS_NO_INDEX) {
+		return pb == OS_NO_INDEX && pa != OS_NO_INDEX;
+	}
+#if MIROS_CFG_SCHED_POLICY == MIROS_SCHED_EDF
+	uint64_t da = OS_prioTable[pa]->deadline;
+	uint64_t db = OS_prioTable[pb]->deadline;
+	if (da != db) {
+		return da < db;
+	}
+#endif
+	return pa < pb;
+}
+
+/* thread mais prioritaria da lista; O(esperando), que costuma ser pouco */
+static OSThread *OS_waitTop(OSWaitList const *wl) {
+	OSWaitList rest = *wl;
+	uint16_t best = OS_NO_INDEX;
+	while (!rest.empty()) {
+		uint16_t i = rest.first();
+		rest.clear(i);
+		if (best == OS_NO_INDEX || OS_threadBefore(i, best)) {
+			best = i;
+		}
+	}
+	return (best == OS_NO_INDEX) ? (OSThread *)0 : OS_thread[best];
+}
+
+/* bloqueia a thread atual na lista; interrupcoes DESABILITADAS na entrada
+* e na saida (reabilitadas durante a troca). Devolve false no timeout.
+*/
+static bool OS_waitOn(OSWaitList *wl, uint32_t timeout) {
+	OSThread *t = OS_curr;
+	/* sem preempcao o PendSV nao sairia e a thread seguiria executando */
+	Q_REQUIRE(t != OS_thread[0] && OS_ceilOwner != (OSPeriodicTask *)t
+			  && preemptionAllowed.isAvailable());
+
+	t->waitList = wl;
+	t->timedOut = false;
+	wl->set(t->index);
+	if (timeout != OS_WAIT_FOREVER) {
+		OSTimerQueue_arm(&OS_timers, &t->timeout, timeout);
+	}
+	OS_clearReady(t->index);
+	OS_sched();
+	__enable_irq(); /* PendSV troca de contexto aqui */
+	__disable_irq();
+	return !t->timedOut;
+}
+
+/* tira a thread da lista e a torna pronta; interrupcoes DESABILITADAS */
+static void OS_wake(OSThread *t) {
+	t->waitList->clear(t->index);
+	t->waitList = (OSWaitList *)0;
+	OSTimerQueue_disarm(&OS_timers, &t->timeout);
+	OS_setReady(t->index);
+}
+
+#if MIROS_CFG_TRACE
+static uint8_t OS_semNum; /* ids de trace ja atribuidos */
+#endif
+
+void OSSem_init(OSSem *me, uint32_t count, uint32_t max) {
+	Q_REQUIRE(max != 0U && count <= max);
+	me->count = count;
+	me->max = max;
+	me->waiters.reset();
+#if MIROS_CFG_TRACE
+	me->traceId = OS_semNum++;
+#endif
+}
+
+bool OSSem_take(OSSem *me, uint32_t timeout) {
+	bool ok = true;
+	__disable_irq();
+	if (me->count != 0U) {
+		me->count--;
+		OS_TRACE(OS_EV_SEM_TAKE, me->traceId);
+	}
+	else if (timeout == 0U) {
+		ok = false;
+	}
+	else {
+		/* quem da o give passa a unidade direto para a thread acordada */
+		OS_TRACE(OS_EV_SEM_BLOCK, me->traceId);
+		ok = OS_waitOn(&me->waiters, timeout);
+	}
+	__enable_irq();
+	return ok;
+}
+
+bool OSSem_give(OSSem *me) {
+	bool ok = true;
+	uint32_t primask = __get_PRIMASK(); /* chamada tambem por ISRs */
+	__disable_irq();
+	OS_TRACE(OS_EV_SEM_GIVE, me->traceId);
+	OSThread *t = OS_waitTop(&me->waiters);
+	if (t != (OSThread *)0) {
+		OS_wake(t);
+		OS_sched();
+	}
+	else if (me->count < me->max) {
+		me->count++;
+	}
+	else {
+		ok = false;
+	}
+	__set_PRIMASK(primask);
+	return ok;
+}
+
+void OSEventFlags_init(OSEventFlags *me) {
+	me->flags = 0U;
+	me->waiters.reset();
+}
+
+/* flags da mascara que satisfazem o modo, ou 0 */
+static inline uint32_t OS_flagsMatch(uint32_t flags, uint32_t mask, uint8_t mode) {
+	uint32_t got = flags & mask;
+	if ((mode & OS_FLAGS_ALL) != 0U) {
+		return (got == mask) ? got : 0U;
+	}
+	return got;
+}
+
+uint32_t OSEventFlags_wait(OSEventFlags *me, uint32_t mask,
+    uint8_t mode, uint32_t timeout) {
+	Q_REQUIRE(mask != 0U);
+	__disable_irq();
+	uint32_t got = OS_flagsMatch(me->flags, mask, mode);
+	if (got != 0U) {
+		if ((mode & OS_FLAGS_CLEAR) != 0U) {
+			me->flags &= ~got;
+		}
+	}
+	else if (timeout != 0U) {
+		OSThread *t = OS_curr;
+		t->waitFlags = mask;
+		t->waitMode = mode;
+		/* OSEventFlags_set ja deixa em waitFlags o que foi recebido */
+		got = OS_waitOn(&me->waiters, timeout) ? t->waitFlags : 0U;
+	}
+	__enable_irq();
+	return got;
+}
+
+void OSEventFlags_set(OSEventFlags *me, uint32_t flags) {
+	uint32_t primask = __get_PRIMASK(); /* chamada tambem por ISRs */
+	__disable_irq();
+	me->flags |= flags;
+
+	/* uma passada so pela lista, com interrupcoes desabilitadas: acorda
+	* toda espera satisfeita pelas flags deste set e so no fim tira as
+	* pedidas com CLEAR. Quem roda primeiro continua sendo decidido pelo
+	* escalonador; consumo exclusivo e papel do OSSem
+	*/
+	OSWaitList rest = me->waiters;
+	uint32_t consumed = 0U;
+	bool woke = false;
+	while (!rest.empty()) {
+		OSThread *t = OS_thread[rest.first()];
+		rest.clear(t->index);
+		uint32_t got = OS_flagsMatch(me->flags, t->waitFlags, t->waitMode);
+		if (got != 0U) {
+			if ((t->waitMode & OS_FLAGS_CLEAR) != 0U) {
+				consumed |= got;
+			}
+			t->waitFlags = got;
+			OS_wake(t);
+			woke = true;
+		}
+	}
+	me->flags &= ~consumed;
+	if (woke) {
+		OS_sched();
+	}
+	__set_PRIMASK(primask);
+}
+
+void OSEventFlags_clear(OSEventFlags *me, uint32_t flags) {
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	me->flags &= ~flags;
+	__set_PRIMASK(primask);
+}
+
 void osPeriodicWrapper() {
 	while (1) {
 		if (OSPeriodic_curr && OSPeriodic_curr->myTask
-				&& (OS_readySet & (1U << ((OSPeriodic_curr->myThreadIndex) - 1U)))) {
+				&& OS_readySet.test(OSPeriodic_curr->myThreadIndex)) {
 			OSPeriodicTask *me = OSPeriodic_curr;
+#if MIROS_CFG_BUDGET
+			/* o job comeca com o orcamento cheio */
+			__disable_irq();
+			me->execCycles = 0U;
+			me->overBudget = false;
+			OS_switchStamp = DWT->CYCCNT;
+#if MIROS_CFG_STATS
+			OS_histAdd(&me->stats.jitter, OS_switchStamp - me->releaseStamp);
+#endif
+			__enable_irq();
+#endif
 			me->myTask();
 
 
-			//essa parte deve ser atomica?? esta certo falar atomica??
-			uint32_t deadline = me->lastAtivation + me->Period;
-			if (deadline <= TempoCiclo) {
-				if (me->lastAtivation != TempoAtual && TempoAtual > deadline) { // || (TempoAtual == TempoCiclo && me->lastAtivation  != 0)
-					Q_ERROR(); // Deadline miss
-
-				}
+			__disable_irq();
+			OS_TRACE(OS_EV_DONE, me->myThreadIndex);
+#if MIROS_CFG_BUDGET
+			uint32_t now = DWT->CYCCNT;
+			uint32_t exec = me->execCycles + (now - OS_switchStamp);
+			if (exec > me->execMax) {
+				me->execMax = exec;
+			}
+#endif
+#if MIROS_CFG_STATS
+			OS_histAdd(&me->stats.exec, exec);
+			OS_histAdd(&me->stats.response, now - me->releaseStamp);
+#endif
+			if (!me->missCounted && OS_time > me->deadline
+				&& OS_missPolicy(me, false) == OS_MISS_SKIP) {
+				OS_skipNext.set(me->myThreadIndex);
+			}
+			me->missCounted = false;
+			OS_clearReady(me->myThreadIndex);
+			if (me->lateJobs != 0U) {
+				/* o mais antigo dos jobs adiados comeca ja */
+				me->deadline = me->nextRelease - (uint64_t)me->lateJobs * me->Period
+						+ me->Deadline;
+#if MIROS_CFG_STATS
+				/* a liberacao adiada nao tem carimbo proprio: estimada
+				* pelo tick, com erro de ate um tick
+				*/
+				me->releaseStamp = now - (uint32_t)(OS_time - (me->deadline - me->Deadline))
+						* (SystemCoreClock / TICKS_PER_SEC);
+#endif
+				me->lateJobs--;
+				me->lateRun = true;
+				OS_setReady(me->myThreadIndex);
 			}
-			// Lógica para deadlines no próximo ciclo
 			else {
+				me->lateRun = false;
+				OS_jobActive.clear(me->myThreadIndex);
+			}
+			OS_sched();
+			__enable_irq();
+		}
+		else {
+			__disable_irq();
+			OS_sched();
+			__enable_irq();
+		}
 
-				uint32_t adjustedDeadline = deadline - TempoCiclo;
-				if (me->lastAtivation != TempoAtual && TempoAtual > adjustedDeadline  ) {
-					Q_ERROR(); // Deadline miss
+	}
+}
+/* limite de Liu & Layland n(2^(1/n) - 1) em Q16, n = 1..32 (truncado);
+* acima disso vale o limite assintotico ln 2
+*/
+static const uint32_t OS_llBound[32] = {
+	65536U, 54291U, 51102U, 49599U, 48725U, 48154U, 47751U, 47452U,
+	47221U, 47037U, 46887U, 46763U, 46658U, 46569U, 46492U, 46424U,
+	46364U, 46312U, 46264U, 46222U, 46184U, 46149U, 46117U, 46088U,
+	46061U, 46037U, 46014U, 45993U, 45973U, 45954U, 45937U, 45921U,
+};
+
+/* utilizacao C/T em Q16, arredondada para cima */
+static uint32_t OS_utilQ16(uint32_t period, uint32_t wcet) {
+	uint64_t periodUs = (uint64_t)period * OS_TICK_US;
+	return (uint32_t)((((uint64_t)wcet << 16) + periodUs - 1U) / periodUs);
+}
 
-				}
+/* slot que uma tarefa com esse deadline relativo ocuparia (mesma regra de
+* OS_assignPrio)
+*/
+static uint16_t OS_prioSlotFor(uint32_t deadline) {
+	uint16_t slot = 0U;
+	while (slot < OS_periodicTaskNum && OS_prioTable[slot]->Deadline <= deadline) {
+		slot++;
+	}
+	return slot;
+}
+
+#if MIROS_CFG_SCHED_POLICY != MIROS_SCHED_EDF
+/* analise exata de tempo de resposta (RM/DM) com a candidata inserida no
+* slot candSlot: R = C_i + soma(ceil(R / T_j) * C_j) para j mais
+* prioritaria, aceita se R <= D_i. R so cresce ate convergir, e a
+* iteracao para assim que passa de D_i: o proprio deadline limita o
+* numero de passos, sem recusar conjuntos que convergem devagar. Tempos
+* em us com 64 bits: periodo * OS_TICK_US e a soma de R
+* passam de 32 bits, e o estouro faria um conjunto inviavel passar. Com
+* C_j <= T_j cada parcela fica abaixo de R + T_j, entao 64 bits bastam.
+*/
+static bool OS_rtaFeasible(uint16_t candSlot, uint32_t period, uint32_t wcet,
+                           uint32_t deadline) {
+	uint16_t num = OS_periodicTaskNum + 1U;
+	static uint64_t T[OS_MAX_THREADS]; /* fora da pilha de main */
+	static uint32_t C[OS_MAX_THREADS];
+	static uint64_t D[OS_MAX_THREADS];
+
+	for (uint16_t k = 0U; k < num; k++) {
+		if (k == candSlot) {
+			T[k] = (uint64_t)period * OS_TICK_US;
+			C[k] = wcet;
+			D[k] = (uint64_t)deadline * OS_TICK_US;
+		}
+		else {
+			OSPeriodicTask const *pt = OS_prioTable[(k < candSlot) ? k : (k - 1U)];
+			T[k] = (uint64_t)pt->Period * OS_TICK_US;
+			C[k] = pt->Wcet;
+			D[k] = (uint64_t)pt->Deadline * OS_TICK_US;
+		}
+	}
+
+	/* so as tarefas a partir da candidata tem a interferencia alterada */
+	for (uint16_t i = candSlot; i < num; i++) {
+		uint64_t R = C[i];
+		for (;;) {
+			uint64_t next = C[i];
+			for (uint16_t j = 0U; j < i; j++) {
+				next += ((R + T[j] - 1U) / T[j]) * C[j];
+			}
+			if (next > D[i]) {
+				return false; /* deadline relativo estourado */
 			}
-			OS_readySet &= ~(1U << (OSPeriodic_curr->myThreadIndex - 1U));
+			if (next == R) {
+				break;
+			}
+			R = next;
+		}
+	}
+	return true;
+}
+#endif
 
-			// se fosse atomica é até aqui???
+bool OS_admissible(uint32_t period, uint32_t wcet, uint32_t deadline) {
+	if (deadline == 0U) {
+		deadline = period;
+	}
+	if (period == 0U || deadline > period
+		|| OS_periodicTaskNum >= Q_DIM(OS_prioTable)) {
+		return false;
+	}
+	if ((uint64_t)wcet > (uint64_t)deadline * OS_TICK_US) {
+		return false;
+	}
+	/* uma tarefa sem WCET entraria com custo zero e a garantia seria falsa */
+	if (OS_undeclaredNum != 0U) {
+		return false;
+	}
 
+	/* utilizacao C/T e densidade C/D; iguais enquanto D = T */
+	uint32_t util = OS_utilQ16(period, wcet);
+	uint32_t density = OS_utilQ16(deadline, wcet);
+	bool implicit = (deadline == period);
+	for (uint16_t n = 0U; n < OS_periodicTaskNum; n++) {
+		OSPeriodicTask const *pt = OSPeriodicTasks[n];
+		util += OS_utilQ16(pt->Period, pt->Wcet);
+		density += OS_utilQ16(pt->Deadline, pt->Wcet);
+		implicit = implicit && (pt->Deadline == pt->Period);
+	}
 
-		}
-		__disable_irq();
-		OS_sched();
-		__enable_irq();
+#if MIROS_CFG_SCHED_POLICY == MIROS_SCHED_EDF
+	/* EDF: exato para U <= 1 com D = T; com D < T so o teste de
+	* densidade, que e suficiente
+	*/
+	(void)util;
+	(void)implicit;
+	return density <= 65536U;
+#else
+	/* suficiente: dentro do limite de Liu & Layland nao precisa de RTA
+	* (o limite so vale com D = T)
+	*/
+	(void)density;
+	uint32_t bound = (OS_periodicTaskNum < Q_DIM(OS_llBound))
+			? OS_llBound[OS_periodicTaskNum] : 45426U; /* ln 2 em Q16 */
+	if (implicit && util <= bound) {
+		return true;
+	}
+	if (util > 65536U) {
+		return false;
+	}
+	return OS_rtaFeasible(OS_prioSlotFor(deadline), period, wcet, deadline);
+#endif
+}
 
+void OSMutex_init(OSMutex *me) {
+	me->ceilTask = (OSPeriodicTask *)0;
+	me->owner = (OSPeriodicTask *)0;
+	me->prevCeil = OS_NO_INDEX;
+	me->prevOwner = (OSPeriodicTask *)0;
+}
+
+/* guarda a usuaria de menor slot; slots novos so deslocam os antigos sem
+* trocar a ordem entre eles, entao o teto continua valido
+*/
+void OSMutex_addUser(OSMutex *me, OSPeriodicTask *user) {
+	__disable_irq();
+	if (me->ceilTask == (OSPeriodicTask *)0 || user->myPrio < me->ceilTask->myPrio) {
+		me->ceilTask = user;
 	}
+	__enable_irq();
+}
+
+void OSMutex_lock(OSMutex *me) {
+	__disable_irq();
+	OSPeriodicTask *curr = (OSPeriodicTask *)OS_curr;
+	/* travado significa uso por tarefa nao declarada ou fora de thread */
+	Q_REQUIRE(me->owner == (OSPeriodicTask *)0
+			  && me->ceilTask != (OSPeriodicTask *)0
+			  && OS_curr != OS_thread[0]);
+	me->owner = curr;
+	curr->mutexHeld++;
+	me->prevCeil = OS_ceilPrio;
+	me->prevOwner = OS_ceilOwner;
+	if (me->ceilTask->myPrio < OS_ceilPrio) {
+		OS_ceilPrio = me->ceilTask->myPrio;
+	}
+	OS_ceilOwner = curr;
+	__enable_irq();
 }
-void OSPeriodicTask_start(OSPeriodicTask *me,
-    OSThreadHandler threadHandler,
-    void *stkSto, uint32_t stkSize, uint32_t period){
-	  Q_REQUIRE(period != 0);
 
+void OSMutex_unlock(OSMutex *me) {
 	__disable_irq();
+	Q_REQUIRE(me->owner == (OSPeriodicTask *)OS_curr);
+	OS_ceilPrio = me->prevCeil;
+	OS_ceilOwner = me->prevOwner;
+	me->owner->mutexHeld--;
+	me->owner = (OSPeriodicTask *)0;
+	OS_sched(); /* quem foi liberado durante o lock executa agora */
+	__enable_irq();
+}
 
-	me->myTask = threadHandler;
+/* insere a tarefa na tabela de prioridades (deadline-monotonic: menor
+* deadline relativo primeiro, o que com D = T e o rate-monotonic; empates
+* pela ordem de criacao) e reconstroi o bitmap de prontas.
+* So roda na partida, com interrupcoes desabilitadas.
+*/
+static void OS_assignPrio(OSPeriodicTask *me) {
+	uint16_t num = OS_periodicTaskNum; /* tarefas ja com slot */
+	uint16_t slot = OS_prioSlotFor(me->Deadline);
+	for (uint16_t i = num; i > slot; i--) {
+		OS_prioTable[i] = OS_prioTable[i - 1U];
+		OS_prioTable[i]->myPrio = i;
+	}
+	OS_prioTable[slot] = me;
+	me->myPrio = slot;
+
+	OS_readyPrio.reset();
+#if MIROS_CFG_SCHED_POLICY == MIROS_SCHED_EDF
+	OS_edfNum = 0U;
+#endif
+	for (uint16_t i = 0U; i <= num; i++) {
+		uint16_t threadIdx = OS_prioTable[i]->myThreadIndex;
+		OS_threadPrio[threadIdx] = i;
+		OS_prioTable[i]->heapIdx = OS_NO_INDEX;
+	}
+	for (uint16_t i = 0U; i <= num; i++) {
+		uint16_t threadIdx = OS_prioTable[i]->myThreadIndex;
+		if (OS_readySet.test(threadIdx)) {
+			OS_setReady(threadIdx);
+		}
+	}
+}
+
+/* registra a thread e o slot de prioridade de uma tarefa periodica
+* (ou do servidor esporadico); interrupcoes DESABILITADAS
+*/
+static void OS_periodicRegister(OSPeriodicTask *me,
+    OSThreadHandler threadEntry,
+    void *stkSto, uint32_t stkSize, uint32_t period, uint32_t wcet,
+    uint32_t deadline) {
 
 	me->Period = period;
+	me->Deadline = deadline;
+	me->Offset = 0U;
+	me->missPolicy = OS_MISS_ASSERT;
+	me->missHandler = (OSMissHandler)0;
+	me->misses = 0U;
+	me->skipped = 0U;
+	me->aborted = 0U;
+	me->lateJobs = 0U;
+	me->lateRun = false;
+	me->missCounted = false;
+	me->mutexHeld = 0U;
+	me->budgetCycles = 0U; /* so tarefas com Wcet declarado, em _start */
+	me->execCycles = 0U;
+	me->execMax = 0U;
+	me->budgetOverruns = 0U;
+	me->budgetAction = OS_BUDGET_SUSPEND;
+	me->overBudget = false;
+#if MIROS_CFG_STATS
+	me->releaseStamp = 0U;
+	me->stats = OSTaskStats{};
+#endif
+	me->Wcet = wcet;
 
-	me->myThreadIndex = OSThread_start(&(me->my_Thread), osPeriodicWrapper, stkSto, stkSize);
+	me->myThreadIndex = OSThread_start(&(me->my_Thread), threadEntry, stkSto, stkSize);
 
 	me->myPeriodicTaskIndex = OS_periodicTaskNum;
+	if (wcet == 0U) {
+		OS_undeclaredNum++;
+	}
 
 	OSPeriodicTasks[OS_periodicTaskNum] = me;
 
-	OS_periodicTaskNum++;
+	/* primeiro job liberado agora */
+	me->nextRelease = OS_time + period;
+	me->deadline = OS_time + deadline;
 
-	me->lastAtivation = TempoAtual;
+	OS_assignPrio(me);
 
-	if (TempoCiclo != 0) {
-		uint32_t new_lcm = lcm(TempoCiclo, period);
-		if (new_lcm == 0 ) { // Verificação correta
-			Q_ERROR();
+	OS_periodicTaskNum++;
+}
+
+bool OSPeriodicTask_start(OSPeriodicTask *me,
+    OSThreadHandler threadHandler,
+    void *stkSto, uint32_t stkSize, uint32_t period,
+    uint32_t wcet, uint32_t offset, uint32_t deadline){
+	  if (deadline == 0U) {
+		  deadline = period;
+	  }
+	  Q_REQUIRE(period != 0);
+	  Q_REQUIRE(offset < period && deadline <= period);
+	  Q_REQUIRE(OS_periodicTaskNum < Q_DIM(OS_prioTable));
+
+	/* a analise roda antes de desabilitar as interrupcoes. Sem WCET a
+	* tarefa so entra num sistema sem tarefas admitidas: a interferencia
+	* dela invalidaria a garantia dada a elas
+	*/
+	if (wcet == 0U) {
+		if (OS_undeclaredNum != OS_periodicTaskNum) {
+			return false;
 		}
-		TempoCiclo = new_lcm;
-	} else {
-		TempoCiclo = period;
+	}
+	else if (!OS_admissible(period, wcet, deadline)) {
+		return false;
+	}
+
+	__disable_irq();
+
+	me->myTask = threadHandler;
+
+	OS_periodicRegister(me, &osPeriodicWrapper, stkSto, stkSize, period, wcet, deadline);
+	me->Offset = offset;
+	me->budgetCycles = wcet * (SystemCoreClock / 1000000U);
+
+	OSTimer_init(&me->release, &OS_periodicRelease, me);
+	if (offset == 0U) {
+		/* primeira liberacao e imediata; a proxima vem um periodo depois */
+		OS_jobActive.set(me->myThreadIndex);
+		OSTimerQueue_arm(&OS_timers, &me->release, period);
+	}
+	else {
+		/* so fica pronta na liberacao defasada */
+		me->nextRelease = OS_time + offset;
+		OS_clearReady(me->myThreadIndex);
+		OSTimerQueue_arm(&OS_timers, &me->release, offset);
 	}
 
   __enable_irq();
+  return true;
+}
+
+bool OSSporadicServer_start(OSSporadicServer *me,
+    void *stkSto, uint32_t stkSize,
+    uint32_t period, uint32_t capacity) {
+	Q_REQUIRE(OS_server == (OSSporadicServer *)0);
+	Q_REQUIRE(capacity != 0U && capacity <= period);
+	Q_REQUIRE(OS_periodicTaskNum < Q_DIM(OS_prioTable));
+
+	/* para a analise o servidor e uma tarefa (Ts, Cs) */
+	uint32_t wcet = capacity * OS_TICK_US;
+	if (!OS_admissible(period, wcet)) {
+		return false;
+	}
+
+	__disable_irq();
+
+	me->task.myTask = (OSThreadHandler)0;
+	me->capacity = capacity;
+	me->budget = capacity;
+	me->consumed = 0U;
+	me->active = false;
+	me->replenishHead = 0U;
+	me->replenishNum = 0U;
+	OSTimer_init(&me->replenishTimer, &OS_serverReplenish, me);
+	/* sem liberacoes periodicas: o servidor so fica pronto quando ativo */
+	OSTimer_init(&me->task.release, (OSTimerHandler)0, me);
+
+	OS_server = me;
+	OS_periodicRegister(&me->task, &OS_serverThread, stkSto, stkSize, period, wcet, period);
+	OS_clearReady(me->task.myThreadIndex);
+	OS_serverActivate(me);
+
+	__enable_irq();
+	return true;
 }
 
-uint8_t OSThread_start(
+uint16_t OSThread_start(
     OSThread *me,
     OSThreadHandler threadHandler,
     void *stkSto, uint32_t stkSize)
 {
-    /* round down the stack top to the 8-byte boundary
-    * NOTE: ARM Cortex-M stack grows down from hi -> low memory
-    */
-    uint32_t *sp = (uint32_t *)((((uint32_t)stkSto + stkSize) / 8) * 8);
-    uint32_t *stk_limit;
-
     /* thread number must be in ragne
     * and must be unused
     */
     Q_REQUIRE((OS_threadNum < Q_DIM(OS_thread)) && (OS_thread[OS_threadNum] == (OSThread *)0));
 
-    *(--sp) = (1U << 24);  /* xPSR */
-    *(--sp) = (uint32_t)threadHandler; /* PC */
-    *(--sp) = 0x0000000EU; /* LR  */
-    *(--sp) = 0x0000000CU; /* R12 */
-    *(--sp) = 0x00000003U; /* R3  */
-    *(--sp) = 0x00000002U; /* R2  */
-    *(--sp) = 0x00000001U; /* R1  */
-    *(--sp) = 0x00000000U; /* R0  */
-    /* additionally, fake registers R4-R11 */
-    *(--sp) = 0x0000000BU; /* R11 */
-    *(--sp) = 0x0000000AU; /* R10 */
-    *(--sp) = 0x00000009U; /* R9 */
-    *(--sp) = 0x00000008U; /* R8 */
-    *(--sp) = 0x00000007U; /* R7 */
-    *(--sp) = 0x00000006U; /* R6 */
-    *(--sp) = 0x00000005U; /* R5 */
-    *(--sp) = 0x00000004U; /* R4 */
-
-    /* save the top of the stack in the thread's attibute */
-    me->sp = sp;
-
-    /* round up the bottom of the stack to the 8-byte boundary */
-    stk_limit = (uint32_t *)(((((uint32_t)stkSto - 1U) / 8) + 1U) * 8);
-
-    /* pre-fill the unused part of the stack with 0xDEADBEEF */
-    for (sp = sp - 1U; sp >= stk_limit; --sp) {
-        *sp = 0xDEADBEEFU;
-    }
+    me->index = OS_threadNum;
+    me->restart = false;
+    /* contexto inicial na pilha (ou na fibra) da thread */
+    OS_portThreadInit(me, threadHandler, stkSto, stkSize);
+    OSTimer_init(&me->timeout, &OS_threadWakeup, me);
+    me->waitList = (OSWaitList *)0;
+    me->timedOut = false;
 
     /* register the thread with the OS */
     OS_thread[OS_threadNum] = me;
+    OS_threadPrio[OS_threadNum] = OS_NO_INDEX; /* sem slot ate ser periodica */
     /* make the thread ready to run */
     if (OS_threadNum > 0U) {
-        OS_readySet |= (1U << (OS_threadNum - 1U));
+        OS_setReady(OS_threadNum);
     }
     OS_threadNum++;
     return OS_threadNum-1;
 }
 /***********************************************/
+/* callbacks da placa; o porte POSIX tem os seus */
+#ifndef MIROS_PORT_POSIX
+#if MIROS_CFG_TICKLESS
+static uint32_t OS_tickReload; /* ciclos do SysTick por tick */
+#endif
+
 void OS_onStartup(void) {
     SystemCoreClockUpdate();
     SysTick_Config(SystemCoreClock / TICKS_PER_SEC);
+#if MIROS_CFG_TICKLESS
+    OS_tickReload = SystemCoreClock / TICKS_PER_SEC;
+#endif
 
     /* set the SysTick interrupt priority (highest) */
     NVIC_SetPriority(SysTick_IRQn, 0U);
 
 }
 
+#if MIROS_CFG_TICKLESS
+/* Tickless idle: dorme ate a proxima expiracao da fila de timeouts com um
+* unico periodo longo do SysTick, em vez de acordar a cada tick.
+* O tick em que o timeout vence continua sendo processado pelo
+* SysTick_Handler; os ticks intermediarios sao contabilizados por
+* OS_tickSkip(), entao os instantes de liberacao nao mudam.
+*/
+void OS_onIdle(void) {
+    __disable_irq();
+
+    /* o LOAD do SysTick tem 24 bits */
+    uint32_t maxTicks = (SysTick_LOAD_RELOAD_Msk + 1U) / OS_tickReload;
+    uint32_t idleTicks = (OS_timers.head != (OSTimer *)0)
+                         ? OS_timers.head->delta : maxTicks;
+#if MIROS_CFG_RELEASE_TABLE
+    if (OS_releaseTableOn && OS_releaseTicksLeft() < idleTicks) {
+        idleTicks = OS_releaseTicksLeft();
+    }
+#endif
+    if (idleTicks > maxTicks) {
+        idleTicks = maxTicks;
+    }
+
+    /* pouco a ganhar, algo ficou pronto ou um tick ja esta pendente */
+    if (idleTicks < 2U || OS_readyTop() != (OSPeriodicTask *)0
+        || (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) != 0U) {
+        __WFI();
+        __enable_irq();
+        return;
+    }
+
+    /* para o contador e estende o tick atual por idleTicks - 1 ticks */
+    SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+    uint32_t remaining = SysTick->VAL;
+    if (remaining == 0U) {
+        remaining = OS_tickReload;
+    }
+    uint32_t sleepLoad = remaining + (idleTicks - 1U) * OS_tickReload - 1U;
+    SysTick->LOAD = sleepLoad;
+    SysTick->VAL = 0U;
+    SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+
+    __DSB();
+    __WFI();
+    __ISB();
+
+    /* a leitura de CTRL limpa o COUNTFLAG: ler uma unica vez */
+    uint32_t ctrl = SysTick->CTRL;
+    SysTick->CTRL = ctrl & ~SysTick_CTRL_ENABLE_Msk;
+    uint32_t val = SysTick->VAL;
+
+    uint32_t skipped;
+    uint32_t nextLoad;
+    if ((ctrl & SysTick_CTRL_COUNTFLAG_Msk) != 0U) {
+        /* dormiu ate o fim: o SysTick pendente processa o ultimo tick */
+        skipped = idleTicks - 1U;
+        uint32_t sinceFire = sleepLoad - val;
+        nextLoad = (sinceFire < OS_tickReload)
+                   ? (OS_tickReload - sinceFire) : OS_tickReload;
+    }
+    else {
+        /* acordado antes por outra interrupcao */
+        uint32_t inTick = (OS_tickReload - remaining) + (sleepLoad - val);
+        skipped = inTick / OS_tickReload;
+        nextLoad = OS_tickReload - (inTick % OS_tickReload);
+    }
+
+    /* termina o tick parcial e volta ao periodo normal no proximo reload */
+    SysTick->LOAD = nextLoad - 1U;
+    SysTick->VAL = 0U;
+    SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+    SysTick->LOAD = OS_tickReload - 1U;
+
+    OS_tickSkip(skipped);
+    uwTick += skipped * (uint32_t)uwTickFreq; /* HAL_IncTick dos ticks pulados */
+
+    __enable_irq();
+}
+#else
 void OS_onIdle(void) {
-#ifdef NDBEBUG
+#ifdef NDEBUG
     __WFI(); /* stop the CPU and Wait for Interrupt */
 #endif
 }
+#endif
+
+#endif /* MIROS_PORT_POSIX */
 
 }//fim namespace
 
+#ifndef MIROS_PORT_POSIX
 void Q_onAssert(char const *module, int loc) {
     /* TBD: damage control */
     (void)module; /* avoid the "unused parameter" compiler warning */
     (void)loc;    /* avoid the "unused parameter" compiler warning */
     NVIC_SystemReset();
 }
+#endif
 
-/***********************************************/
-
-/*
-*/
-__attribute__ ((naked, optimize("-fno-stack-protector")))
-void PendSV_Handler(void) {
-
-__asm volatile (
-
-    /* __disable_irq(); */
-    "  CPSID         I                 \n"
-
-    /* if (OS_curr != (OSThread *)0) { */
-    "  LDR           r1,=_ZN4rtos7OS_currE       \n"
-    "  LDR           r1,[r1,#0x00]     \n"
-    "  CBZ           r1,PendSV_restore \n"
-
- // Salva FPU (se usada)
-	"  MRS    r0, CONTROL           \n"
-	"  TST    r0, #0x10             \n" // Bit FPCA
-	"  BEQ    save_no_fpu          \n"
-	"  SUB    sp, sp, #(17*4)      \n" // Reserva espaço: 16 S regs + FPSCR
-	"  VSTMDB sp!, {s16-s31}       \n" // Salva s16-s31
-	"  VMRS   r1, FPSCR            \n"
-	"  STR    r1, [sp, #(16*4)]    \n"
-	"save_no_fpu:                  \n"
-    /*     push registers r4-r11 on the stack */
-    "  PUSH          {r4-r11}          \n"
-
-    /*     OS_curr->sp = sp; */
-    "  LDR           r1,=_ZN4rtos7OS_currE       \n"
-    "  LDR           r1,[r1,#0x00]     \n"
-    "  STR           sp,[r1,#0x00]     \n"
-    /* } */
-
-    "PendSV_restore:                   \n"
-    /* sp = OS_next->sp; */
-    "  LDR           r1,=_ZN4rtos7OS_nextE       \n"
-    "  LDR           r1,[r1,#0x00]     \n"
-    "  LDR           sp,[r1,#0x00]     \n"
-
-    /* OS_curr = OS_next; */
-    "  LDR           r1,=_ZN4rtos7OS_nextE       \n"
-    "  LDR           r1,[r1,#0x00]     \n"
-    "  LDR           r2,=_ZN4rtos7OS_currE       \n"
-    "  STR           r1,[r2,#0x00]     \n"
-
-    /* pop registers r4-r11 */
-    "  POP           {r4-r11}          \n"
-
-  // Restaura FPU (se usada)
-		"  MRS    r0, CONTROL          \n"
-		"  TST    r0, #0x10            \n"
-		"  BEQ    restore_no_fpu      \n"
-		"  VLDMIA sp!, {s16-s31}      \n"
-		"  LDR    r1, [sp], #(16*4)   \n"
-		"  VMSR   FPSCR, r1           \n"
-		"restore_no_fpu:              \n"
-
-    /* __enable_irq(); */
-    "  CPSIE         I                 \n"
-
-    /* return to the next thread */
-    "  BX            lr                \n"
-    );
-}
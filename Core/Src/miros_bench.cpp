@@ -0,0 +1,588 @@
+/*
+ * miros_bench.cpp
+ *
+ * Compara o custo por tick do loop antigo de OS_tick (decremento de
+ * OS_thread[n]->timeout + checkDeadline para cada tarefa) com a fila de
+ * timeouts OSTimerQueue, para 4, 16 e 32 tarefas periodicas.
+ *
+ * Os dois lados usam o mesmo conjunto de periodos e rodam um numero
+ * fixo de ticks; o resultado em ciclos fica em OS_benchTick[].
+ *
+ * Mede tambem enfileirar/retirar jobs aperiodicos na fila do kernel
+ * (anel + heap de deadlines) com 1/4, 1/2 e toda a capacidade ocupada;
+ * resultado em OS_benchJobs[].
+ *
+ * Compara o passo do PID antigo em double (testePid de main.cpp) com o
+ * motor de pid.h em float e em Q31.
+ *
+ * Toda medicao tambem vira uma linha de OS_benchResults[], e
+ * OS_benchDone() acrescenta a pilha usada por cada thread. Com
+ * MIROS_BENCH_SUITE as tarefas benchHi/benchLo medem o kernel rodando e
+ * acrescentam as suas linhas; a benchLo chama OS_benchDone() depois que
+ * o pipeline de controle grava a linha pipeline_latency.
+ */
+#ifdef MIROS_BENCH
+
+#include <cstdint>
+#include "miros.h"
+#include "miros_bench.h"
+#include "stm32g4xx.h"
+#include "pid.h"
+#include "qassert.h"
+#ifdef MIROS_BENCH_SUITE
+#include "miros_port.h"
+#include "miros_trace.h"
+#include "controle.h"
+#endif
+
+Q_DEFINE_THIS_FILE
+
+namespace rtos {
+
+OSBenchTick OS_benchTick[3];
+OSBenchJobs OS_benchJobs[3];
+OSBenchResult OS_benchResults[OS_BENCH_MAX_RESULTS];
+uint32_t OS_benchCount;
+bool volatile OS_benchFinished;
+
+/* acrescenta a serie na tabela; linhas alem da capacidade sao perdidas */
+void OS_benchAddResult(char const *name, uint32_t param, OSBenchAcc const *a) {
+	if (OS_benchCount >= OS_BENCH_MAX_RESULTS) {
+		return;
+	}
+	OSBenchResult *r = &OS_benchResults[OS_benchCount++];
+	r->name = name;
+	r->param = param;
+	r->samples = a->n;
+	r->min = (a->n == 0U) ? 0U : a->min;
+	r->avg = OS_benchAccAvg(a);
+	r->max = a->max;
+}
+
+static const uint32_t BENCH_TICKS = 1000U;
+static const uint32_t BENCH_MAX_TASKS = 32U;
+
+/* copia do estado usado pelo loop antigo */
+static struct {
+	uint32_t timeout[BENCH_MAX_TASKS];
+	uint32_t Period[BENCH_MAX_TASKS];
+	uint32_t lastAtivation[BENCH_MAX_TASKS];
+	uint32_t readySet;
+	uint32_t TempoAtual;
+	uint32_t TempoCiclo;
+	uint32_t num;
+} legacy;
+
+/* periodos variados entre 10 e 40 ticks */
+static uint32_t benchPeriod(uint32_t n) {
+	return 10U + ((n * 7U) % 31U);
+}
+
+/* checkDeadline como era antes da fila de timeouts (sem o Q_ERROR:
+* o benchmark limpa os prontos a cada tick)
+*/
+static void legacyCheckDeadline(uint32_t n) {
+	uint32_t deadline = legacy.lastAtivation[n] + legacy.Period[n];
+	if (deadline <= legacy.TempoCiclo) {
+		if (legacy.TempoAtual >= deadline) {
+			if (legacy.TempoAtual == deadline) {
+				legacy.readySet |= (1U << n);
+				legacy.lastAtivation[n] = legacy.TempoAtual;
+			}
+		}
+	}
+	else {
+		uint32_t adjustedDeadline = deadline - legacy.TempoCiclo;
+		if (legacy.TempoAtual == adjustedDeadline) {
+			legacy.readySet |= (1U << n);
+			legacy.lastAtivation[n] = legacy.TempoAtual;
+		}
+	}
+}
+
+static void legacyTick(void) {
+	legacy.TempoAtual++;
+	if (legacy.TempoAtual > legacy.TempoCiclo) {
+		legacy.TempoAtual = 0;
+	}
+	for (uint32_t n = 0U; n < legacy.num; n++) {
+		if (legacy.timeout[n] != 0U) {
+			legacy.timeout[n]--;
+			if (legacy.timeout[n] == 0U) {
+				legacy.readySet |= (1U << n);
+			}
+		}
+	}
+	for (uint32_t n = 0U; n < legacy.num; n++) {
+		legacyCheckDeadline(n);
+	}
+}
+
+/* lado novo: mesma carga de liberacoes sobre uma fila propria */
+static OSTimerQueue benchQueue;
+static OSTimer benchTimer[BENCH_MAX_TASKS];
+static uint32_t benchReady;
+
+static void benchRelease(void *arg) {
+	uint32_t n = (uint32_t)arg;
+	benchReady |= (1U << n);
+	OSTimerQueue_arm(&benchQueue, &benchTimer[n], benchPeriod(n));
+}
+
+void OS_benchInit(void) {
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0U;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+static void benchTickCost(OSBenchTick *r, uint32_t num) {
+	OSBenchAcc acc;
+
+	legacy.num = num;
+	legacy.TempoAtual = 0U;
+	legacy.TempoCiclo = 0U;
+	legacy.readySet = 0U;
+	benchQueue.head = (OSTimer *)0;
+	for (uint32_t n = 0U; n < num; n++) {
+		legacy.timeout[n] = 0U;
+		legacy.Period[n] = benchPeriod(n);
+		legacy.lastAtivation[n] = 0U;
+		legacy.TempoCiclo = (legacy.TempoCiclo == 0U)
+				? legacy.Period[n]
+				: lcm(legacy.TempoCiclo, legacy.Period[n]);
+
+		OSTimer_init(&benchTimer[n], &benchRelease, (void *)n);
+		OSTimerQueue_arm(&benchQueue, &benchTimer[n], benchPeriod(n));
+	}
+
+	OS_benchAccReset(&acc);
+	for (uint32_t t = 0U; t < BENCH_TICKS; t++) {
+		uint32_t start = DWT->CYCCNT;
+		legacyTick();
+		OS_benchAccAdd(&acc, DWT->CYCCNT - start);
+		legacy.readySet = 0U;
+	}
+	r->legacyAvg = OS_benchAccAvg(&acc);
+	r->legacyMax = acc.max;
+	OS_benchAddResult("tick_legacy", num, &acc);
+
+	OS_benchAccReset(&acc);
+	for (uint32_t t = 0U; t < BENCH_TICKS; t++) {
+		uint32_t start = DWT->CYCCNT;
+		OSTimerQueue_tick(&benchQueue);
+		OS_benchAccAdd(&acc, DWT->CYCCNT - start);
+		benchReady = 0U;
+	}
+	r->timerAvg = OS_benchAccAvg(&acc);
+	r->timerMax = acc.max;
+	OS_benchAddResult("tick_timerq", num, &acc);
+	r->threads = num;
+}
+
+/* jobs aperiodicos: o caminho do kernel, na fila de verdade
+* (OS_aperiodicQueue + OS_jobHeap, MIROS_CFG_APERIODIC_QUEUE_LEN jobs).
+* Roda antes de OS_init, sem servidor: OSAperiodicTask_start so enfileira
+* no anel, e cada osAperiodicWrapper() passa o anel para o heap e executa
+* um job vazio. A fila fica vazia no fim
+*/
+static const uint32_t BENCH_JOB_ITER = 200U;
+static const uint16_t BENCH_MAX_JOBS = MIROS_CFG_APERIODIC_QUEUE_LEN;
+
+static OSAperiodicTask benchJob[BENCH_MAX_JOBS];
+static OSAperiodicTask *benchJobLast; /* ultimo job executado */
+static uint32_t benchSeed;
+
+static void benchNop(void *arg) {
+	benchJobLast = (OSAperiodicTask *)arg;
+}
+
+/* deadlines relativos pseudo-aleatorios; um em cada oito sem deadline */
+static uint32_t benchDeadline(void) {
+	benchSeed = benchSeed * 1664525U + 1013904223U;
+	if ((benchSeed >> 29) == 0U) {
+		return 0U;
+	}
+	return 1000U + (benchSeed >> 20);
+}
+
+static void benchJobPost(OSAperiodicTask *job) {
+	Q_ALLEGE(OSAperiodicTask_start(job, &benchNop, job, benchDeadline()));
+}
+
+static void benchJobCost(OSBenchJobs *r, uint32_t pending) {
+	OSBenchAcc enq;
+	OSBenchAcc deq;
+
+	Q_REQUIRE(pending < BENCH_MAX_JOBS);
+	benchSeed = pending;
+	/* pending + 1 no anel; a primeira retirada deixa pending no heap */
+	for (uint32_t n = 0U; n <= pending; n++) {
+		benchJobPost(&benchJob[n]);
+	}
+	osAperiodicWrapper();
+
+	/* regime: entra um, sai um, a fila continua com pending jobs */
+	OS_benchAccReset(&enq);
+	OS_benchAccReset(&deq);
+	for (uint32_t i = 0U; i < BENCH_JOB_ITER; i++) {
+		uint32_t start = DWT->CYCCNT;
+		benchJobPost(benchJobLast);
+		OS_benchAccAdd(&enq, DWT->CYCCNT - start);
+
+		start = DWT->CYCCNT;
+		osAperiodicWrapper();
+		OS_benchAccAdd(&deq, DWT->CYCCNT - start);
+	}
+	for (uint32_t n = 0U; n < pending; n++) {
+		osAperiodicWrapper();
+	}
+
+	r->pending = pending;
+	r->enqueueAvg = OS_benchAccAvg(&enq);
+	r->enqueueMax = enq.max;
+	r->dequeueAvg = OS_benchAccAvg(&deq);
+	r->dequeueMax = deq.max;
+	OS_benchAddResult("job_enqueue", pending, &enq);
+	OS_benchAddResult("job_dequeue", pending, &deq);
+}
+
+/* PID antigo (testePid de main.cpp), em double: no M4F cada operacao e
+* uma chamada da biblioteca de ponto flutuante em software
+*/
+static struct {
+	double erroIntegral;
+	double ultimoErro;
+} legacyPid;
+
+static double legacyPidStep(double medida, double setpoint) {
+	double erro = setpoint - medida;
+	double proporcional = -0.0001 * erro;
+	legacyPid.erroIntegral += erro * 0.050;
+	double integral = -0.00001 * legacyPid.erroIntegral;
+	double derivativo = -0.00001 * (erro - legacyPid.ultimoErro) / 0.050;
+	legacyPid.ultimoErro = erro;
+	if (proporcional + integral + derivativo < -0.3) {
+		return -30;
+	}
+	if (proporcional + integral + derivativo > 0.3) {
+		return 30;
+	}
+	return (proporcional + integral + derivativo) * 100;
+}
+
+static const uint32_t BENCH_PID_ITER = 200U;
+
+static double volatile benchPidDouble;
+static float volatile benchPidFloat;
+static int32_t volatile benchPidQ31;
+
+/* medidas pseudo-aleatorias na faixa do sensor (20 a 950 mm) */
+static uint16_t benchMedida(void) {
+	benchSeed = benchSeed * 1664525U + 1013904223U;
+	return (uint16_t)(20U + (benchSeed >> 16) % 931U);
+}
+
+/* os tres com os mesmos ganhos, setpoint e sequencia de medidas */
+static void benchPidCost(void) {
+	OSBenchAcc acc;
+	PidConfig cfg = { -0.01f, -0.001f, -0.001f, 0.050f, -30.0f, 30.0f };
+	PidF pf;
+	PidQ31 pq;
+	uint16_t const setpoint = 300U;
+
+	benchSeed = 1U;
+	OS_benchAccReset(&acc);
+	for (uint32_t i = 0U; i < BENCH_PID_ITER; i++) {
+		double m = benchMedida();
+		uint32_t start = DWT->CYCCNT;
+		benchPidDouble = legacyPidStep(m, setpoint);
+		OS_benchAccAdd(&acc, DWT->CYCCNT - start);
+	}
+	OS_benchAddResult("pid_double", 0U, &acc);
+
+	pidInitF(&pf, &cfg);
+	benchSeed = 1U;
+	OS_benchAccReset(&acc);
+	for (uint32_t i = 0U; i < BENCH_PID_ITER; i++) {
+		float erro = (float)setpoint - (float)benchMedida();
+		uint32_t start = DWT->CYCCNT;
+		benchPidFloat = pidUpdateF(&pf, erro);
+		OS_benchAccAdd(&acc, DWT->CYCCNT - start);
+	}
+	OS_benchAddResult("pid_float", 0U, &acc);
+
+	/* erro em fracao de 1024 mm, saida em fracao de 64 % */
+	pidInitQ31(&pq, &cfg, 1024.0f, 64.0f);
+	benchSeed = 1U;
+	OS_benchAccReset(&acc);
+	for (uint32_t i = 0U; i < BENCH_PID_ITER; i++) {
+		int32_t erro = ((int32_t)setpoint - (int32_t)benchMedida()) * (1 << 21);
+		uint32_t start = DWT->CYCCNT;
+		benchPidQ31 = pidUpdateQ31(&pq, erro);
+		OS_benchAccAdd(&acc, DWT->CYCCNT - start);
+	}
+	OS_benchAddResult("pid_q31", 0U, &acc);
+}
+
+void OS_benchRun(void) {
+	OS_benchInit();
+
+	__disable_irq();
+	benchTickCost(&OS_benchTick[0], 4U);
+	benchTickCost(&OS_benchTick[1], 16U);
+	benchTickCost(&OS_benchTick[2], 32U);
+	benchJobCost(&OS_benchJobs[0], BENCH_MAX_JOBS / 4U);
+	benchJobCost(&OS_benchJobs[1], BENCH_MAX_JOBS / 2U);
+	benchJobCost(&OS_benchJobs[2], BENCH_MAX_JOBS - 1U);
+	benchPidCost();
+	__enable_irq();
+}
+
+/* fora de linha para ter endereco proprio: e o simbolo do hook do Renode.
+* Antes de marcar o fim grava a pilha usada por cada thread ate aqui (uma
+* linha stack_used por thread, parametro = indice, valores em bytes)
+*/
+__attribute__((noinline))
+void OS_benchDone(void) {
+#if MIROS_CFG_STACK_CHECK
+	OSBenchAcc acc;
+	for (uint16_t i = 0U; i < OS_threadNum; i++) {
+		OS_benchAccReset(&acc);
+		OS_benchAccAdd(&acc, OS_stackUsed(i));
+		OS_benchAddResult("stack_used", i, &acc);
+	}
+#endif
+	OS_benchFinished = true;
+	__asm volatile ("" ::: "memory");
+}
+
+#ifdef MIROS_BENCH_SUITE
+
+#ifndef MIROS_BENCH_FILLERS
+#define MIROS_BENCH_FILLERS 8 /* tarefas periodicas extras, so carga */
+#endif
+
+/* suite com o kernel rodando. benchHi e benchLo sao liberadas juntas;
+* benchHi (deadline menor) so espera nos semaforos e benchLo conduz as
+* medicoes num unico job. As fillers tem deadlines maiores: entram na
+* fila de timeouts e no OS_tick, mas so executam depois de benchLo.
+* O pipeline de controle roda junto (sensor e ventilador falsos) para a
+* linha pipeline_latency; BENCH_OFFSET tira as medicoes de perto das
+* liberacoes dele (0, +2 e +3 a cada 50 ticks).
+*/
+static const uint32_t BENCH_ITER = 100U;
+static const uint32_t BENCH_PERIOD = 100U; /* ticks */
+static const uint32_t BENCH_OFFSET = 10U;
+static const uint32_t BENCH_HI_DEADLINE = 10U;
+static const uint32_t BENCH_LO_DEADLINE = 20U;
+/* WCETs em us so para a admissao, que recusaria tarefas sem WCET ao lado
+* do pipeline: o primeiro job de cada uma faz todas as medicoes
+*/
+static const uint32_t BENCH_HI_WCET = 10000U;
+static const uint32_t BENCH_LO_WCET = 50000U;
+static const uint32_t BENCH_FILLER_WCET = 100U;
+static const uint32_t BENCH_THREADS = 3U + MIROS_BENCH_FILLERS + 3U; /* idle e o pipeline */
+static const IRQn_Type BENCH_IRQ = FMAC_IRQn; /* sem uso na placa */
+
+static uint32_t stack_benchHi[128];
+static uint32_t stack_benchLo[256];
+static uint32_t stack_benchFiller[MIROS_BENCH_FILLERS][128];
+
+static OSPeriodicTask benchHi;
+static OSPeriodicTask benchLo;
+static OSPeriodicTask benchFiller[MIROS_BENCH_FILLERS];
+
+static OSSem benchSemFree; /* sem disputa: take/give */
+static OSSem benchSemHandoff; /* benchLo -> benchHi */
+static OSSem benchSemIsr; /* BENCH_IRQ -> benchHi */
+static OSMutex benchMutex;
+
+static bool volatile benchMedido; /* linhas da benchLo ja na tabela */
+static uint32_t volatile benchStamp; /* CYCCNT antes do give/pend */
+static float volatile benchFloat = 1.0f;
+
+static OSBenchAcc benchAccHandoff;
+static OSBenchAcc benchAccIsrEntry;
+static OSBenchAcc benchAccIsrTask;
+static OSBenchAcc benchAccTick = { 0U, 0xFFFFFFFFU, 0U, 0U };
+
+void OS_benchTickSample(uint32_t cycles) {
+	OS_benchAccAdd(&benchAccTick, cycles);
+}
+
+/* PendSV com OS_next == OS_curr: salva e restaura a propria thread, o
+* custo completo de uma troca (entrada, hook, saida) sem o escalonador
+*/
+static void benchSelfSwitch(OSBenchAcc *acc, bool fpu) {
+	for (uint32_t i = 0U; i < BENCH_ITER; i++) {
+		if (fpu) {
+			benchFloat = benchFloat * 1.5f; /* contexto de FPU ativo */
+		}
+		uint32_t start = DWT->CYCCNT;
+		OS_portPendSwitch();
+		__DSB();
+		__ISB();
+		OS_benchAccAdd(acc, DWT->CYCCNT - start);
+	}
+}
+
+static void benchHiJob() {
+	if (benchMedido) {
+		return;
+	}
+	/* acordada pelo give de benchLo */
+	for (uint32_t i = 0U; i < BENCH_ITER; i++) {
+		OSSem_take(&benchSemHandoff, OS_WAIT_FOREVER);
+		OS_benchAccAdd(&benchAccHandoff, DWT->CYCCNT - benchStamp);
+	}
+	/* acordada pela ISR */
+	for (uint32_t i = 0U; i < BENCH_ITER; i++) {
+		OSSem_take(&benchSemIsr, OS_WAIT_FOREVER);
+		OS_benchAccAdd(&benchAccIsrTask, DWT->CYCCNT - benchStamp);
+	}
+}
+
+static void benchLoJob() {
+	OSBenchAcc acc;
+	OSBenchAcc acc2;
+	uint32_t start;
+
+	if (OS_benchFinished) {
+		return;
+	}
+	if (benchMedido) {
+		/* jobs seguintes so esperam a linha do pipeline */
+		if (controleLatenciaPronta) {
+			OS_benchDone();
+		}
+		return;
+	}
+
+	/* custo da propria medicao */
+	OS_benchAccReset(&acc);
+	for (uint32_t i = 0U; i < BENCH_ITER; i++) {
+		start = DWT->CYCCNT;
+		OS_benchAccAdd(&acc, DWT->CYCCNT - start);
+	}
+	OS_benchAddResult("cyccnt_overhead", 0U, &acc);
+
+	/* benchLo e a pronta mais prioritaria: OS_sched decide e nao troca */
+	OS_benchAccReset(&acc);
+	for (uint32_t i = 0U; i < BENCH_ITER; i++) {
+		__disable_irq();
+		start = DWT->CYCCNT;
+		OS_sched();
+		uint32_t cycles = DWT->CYCCNT - start;
+		__enable_irq();
+		OS_benchAccAdd(&acc, cycles);
+	}
+	OS_benchAddResult("os_sched", BENCH_THREADS, &acc);
+
+	OS_benchAccReset(&acc);
+	OS_benchAccReset(&acc2);
+	for (uint32_t i = 0U; i < BENCH_ITER; i++) {
+		start = DWT->CYCCNT;
+		OSSem_take(&benchSemFree, 0U);
+		OS_benchAccAdd(&acc, DWT->CYCCNT - start);
+		start = DWT->CYCCNT;
+		OSSem_give(&benchSemFree);
+		OS_benchAccAdd(&acc2, DWT->CYCCNT - start);
+	}
+	OS_benchAddResult("sem_take", 0U, &acc);
+	OS_benchAddResult("sem_give", 0U, &acc2);
+
+	OS_benchAccReset(&acc);
+	OS_benchAccReset(&acc2);
+	for (uint32_t i = 0U; i < BENCH_ITER; i++) {
+		start = DWT->CYCCNT;
+		OSMutex_lock(&benchMutex);
+		OS_benchAccAdd(&acc, DWT->CYCCNT - start);
+		start = DWT->CYCCNT;
+		OSMutex_unlock(&benchMutex);
+		OS_benchAccAdd(&acc2, DWT->CYCCNT - start);
+	}
+	OS_benchAddResult("mutex_lock", 0U, &acc);
+	OS_benchAddResult("mutex_unlock", 0U, &acc2);
+
+	OS_benchAccReset(&acc);
+	benchSelfSwitch(&acc, false);
+	OS_benchAddResult("ctxsw", 0U, &acc);
+
+	/* give -> benchHi executando: wake + OS_sched + PendSV */
+	OS_benchAccReset(&benchAccHandoff);
+	for (uint32_t i = 0U; i < BENCH_ITER; i++) {
+		benchStamp = DWT->CYCCNT;
+		OSSem_give(&benchSemHandoff);
+	}
+	OS_benchAddResult("sem_handoff", 0U, &benchAccHandoff);
+
+	/* pend da IRQ -> primeira instrucao da ISR -> benchHi executando */
+	OS_benchAccReset(&benchAccIsrEntry);
+	OS_benchAccReset(&benchAccIsrTask);
+	for (uint32_t i = 0U; i < BENCH_ITER; i++) {
+		benchStamp = DWT->CYCCNT;
+		NVIC_SetPendingIRQ(BENCH_IRQ);
+		__DSB();
+		__ISB();
+	}
+	OS_benchAddResult("isr_entry", 0U, &benchAccIsrEntry);
+	OS_benchAddResult("isr_to_task", 0U, &benchAccIsrTask);
+
+	/* por ultimo: depois daqui a thread tem contexto de FPU */
+	OS_benchAccReset(&acc);
+	benchSelfSwitch(&acc, true);
+	OS_benchAddResult("ctxsw_fpu", 0U, &acc);
+
+	__disable_irq();
+	acc = benchAccTick;
+	__enable_irq();
+	OS_benchAddResult("os_tick", BENCH_THREADS, &acc);
+
+	benchMedido = true;
+}
+
+static void benchFillerJob() {
+}
+
+void OS_benchSuiteStart(void) {
+	OSSem_init(&benchSemFree, 1U, 1U);
+	OSSem_init(&benchSemHandoff, 0U, 1U);
+	OSSem_init(&benchSemIsr, 0U, 1U);
+	OSMutex_init(&benchMutex);
+
+	Q_ALLEGE(OSPeriodicTask_start(&benchHi, &benchHiJob,
+			stack_benchHi, sizeof(stack_benchHi),
+			BENCH_PERIOD, BENCH_HI_WCET, BENCH_OFFSET, BENCH_HI_DEADLINE));
+	Q_ALLEGE(OSPeriodicTask_start(&benchLo, &benchLoJob,
+			stack_benchLo, sizeof(stack_benchLo),
+			BENCH_PERIOD, BENCH_LO_WCET, BENCH_OFFSET, BENCH_LO_DEADLINE));
+	for (uint32_t n = 0U; n < MIROS_BENCH_FILLERS; n++) {
+		/* periodos de 50 a 80 ticks: deadlines atras de benchLo */
+		Q_ALLEGE(OSPeriodicTask_start(&benchFiller[n], &benchFillerJob,
+				stack_benchFiller[n], sizeof(stack_benchFiller[n]),
+				40U + benchPeriod(n), BENCH_FILLER_WCET));
+	}
+	/* o orcamento nao pode suspender uma medicao no meio */
+	OSPeriodicTask_setBudgetAction(&benchHi, OS_BUDGET_NOTIFY);
+	OSPeriodicTask_setBudgetAction(&benchLo, OS_BUDGET_NOTIFY);
+	OSMutex_addUser(&benchMutex, &benchLo);
+
+	NVIC_SetPriority(BENCH_IRQ, 5U);
+	NVIC_EnableIRQ(BENCH_IRQ);
+}
+
+#endif /* MIROS_BENCH_SUITE */
+
+}
+
+#ifdef MIROS_BENCH_SUITE
+extern "C" void FMAC_IRQHandler(void) {
+	uint32_t now = DWT->CYCCNT;
+	OS_TRACE_ISR_ENTER();
+	rtos::OS_benchAccAdd(&rtos::benchAccIsrEntry, now - rtos::benchStamp);
+	rtos::OSSem_give(&rtos::benchSemIsr);
+	OS_TRACE_ISR_EXIT();
+}
+#endif
+
+#endif /* MIROS_BENCH */
@@ -0,0 +1,150 @@
+/*
+ * miros_port_cm4.cpp
+ *
+ * Porte do MiROS para o Cortex-M4F (GNU-ARM): frame inicial das threads,
+ * recomeco de jobs abortados e o PendSV_Handler. Fora da build quando
+ * MIROS_PORT_POSIX esta definido.
+ */
+#ifndef MIROS_PORT_POSIX
+
+#include <cstdint>
+#include "miros.h"
+#include "miros_port.h"
+
+namespace rtos {
+
+void OS_portInit(void) {
+    /* set the PendSV interrupt priority to the lowest level 0xFF */
+    *(uint32_t volatile *)0xE000ED20 |= (0xFFU << 16);
+}
+
+/* frame de uma thread que ainda nao executou, logo abaixo de stkTop:
+* o que o PendSV salva (r4-r11 e EXC_RETURN) sobre o frame basico do
+* hardware; devolve o sp salvo
+*/
+static uint32_t *OS_portFrame(uint32_t *sp, OSThreadHandler entry) {
+    *(--sp) = (1U << 24);  /* xPSR */
+    *(--sp) = (uint32_t)entry; /* PC */
+    *(--sp) = 0x0000000EU; /* LR  */
+    *(--sp) = 0x0000000CU; /* R12 */
+    *(--sp) = 0x00000003U; /* R3  */
+    *(--sp) = 0x00000002U; /* R2  */
+    *(--sp) = 0x00000001U; /* R1  */
+    *(--sp) = 0x00000000U; /* R0  */
+    /* EXC_RETURN: modo thread, MSP, sem contexto de FPU */
+    *(--sp) = 0xFFFFFFF9U;
+    /* additionally, fake registers R4-R11 */
+    *(--sp) = 0x0000000BU; /* R11 */
+    *(--sp) = 0x0000000AU; /* R10 */
+    *(--sp) = 0x00000009U; /* R9 */
+    *(--sp) = 0x00000008U; /* R8 */
+    *(--sp) = 0x00000007U; /* R7 */
+    *(--sp) = 0x00000006U; /* R6 */
+    *(--sp) = 0x00000005U; /* R5 */
+    *(--sp) = 0x00000004U; /* R4 */
+    return sp;
+}
+
+void OS_portThreadInit(OSThread *me, OSThreadHandler entry,
+    void *stkSto, uint32_t stkSize) {
+    /* round down the stack top to the 8-byte boundary
+    * NOTE: ARM Cortex-M stack grows down from hi -> low memory
+    */
+    uint32_t *sp = (uint32_t *)((((uint32_t)stkSto + stkSize) / 8) * 8);
+    uint32_t *stk_limit;
+
+    me->stkTop = sp;
+    sp = OS_portFrame(sp, entry);
+
+    /* save the top of the stack in the thread's attibute */
+    me->sp = sp;
+
+    /* round up the bottom of the stack to the 8-byte boundary */
+    stk_limit = (uint32_t *)(((((uint32_t)stkSto - 1U) / 8) + 1U) * 8);
+    me->stkBase = stk_limit;
+
+    /* pre-fill the unused part of the stack with 0xDEADBEEF */
+    for (sp = sp - 1U; sp >= stk_limit; --sp) {
+        *sp = OS_STACK_PAINT;
+    }
+}
+
+/* descarta o contexto salvo (basico ou estendido, com FPU) e poe um
+* frame novo no topo da pilha, que comeca no osPeriodicWrapper;
+* interrupcoes DESABILITADAS. Chamada tambem pelo OS_switchHook com a
+* pilha da propria thread: o frame novo fica acima do contexto salvo,
+* e o hook executa abaixo dele.
+*/
+void OS_portThreadRestart(OSThread *me) {
+	me->sp = OS_portFrame((uint32_t *)me->stkTop, &osPeriodicWrapper);
+}
+
+}
+
+/***********************************************/
+
+/* troca de contexto com empilhamento lazy da FPU (ASPEN e LSPEN ligados):
+* o hardware so reserva s0-s15 no frame de quem usou a FPU, e o bit 4 do
+* EXC_RETURN diz se o frame e estendido. s16-s31 so sao salvos nesse caso,
+* e o EXC_RETURN fica no contexto de cada thread; threads so de inteiros
+* nao pagam nada pela FPU.
+*
+* Contexto salvo (de OSThread.sp para cima): r4-r11, EXC_RETURN,
+* [s16-s31 se EXC_RETURN[4] == 0], frame do hardware.
+*/
+__attribute__ ((naked, optimize("-fno-stack-protector")))
+void PendSV_Handler(void) {
+
+__asm volatile (
+
+    /* __disable_irq(); */
+    "  CPSID         I                 \n"
+
+    /* if (OS_curr != (OSThread *)0) { */
+    "  LDR           r1,=_ZN4rtos7OS_currE       \n"
+    "  LDR           r1,[r1,#0x00]     \n"
+    "  CBZ           r1,PendSV_restore \n"
+
+    /*     frame estendido: salva s16-s31 (e dispara o lazy de s0-s15) */
+    "  TST           lr,#0x10          \n"
+    "  IT            EQ                \n"
+    "  VSTMDBEQ      sp!,{s16-s31}     \n"
+
+    /*     push registers r4-r11 and EXC_RETURN on the stack */
+    "  PUSH          {r4-r11,lr}       \n"
+
+    /*     OS_curr->sp = sp; */
+    "  STR           sp,[r1,#0x00]     \n"
+
+    /*     OS_switchHook(); com a pilha alinhada em 8 */
+    "  SUB           sp,sp,#4          \n"
+    "  BL            _ZN4rtos13OS_switchHookEv \n"
+    /* } */
+
+    "PendSV_restore:                   \n"
+    /* sp = OS_next->sp; */
+    "  LDR           r1,=_ZN4rtos7OS_nextE       \n"
+    "  LDR           r1,[r1,#0x00]     \n"
+    "  LDR           sp,[r1,#0x00]     \n"
+
+    /* OS_curr = OS_next; */
+    "  LDR           r2,=_ZN4rtos7OS_currE       \n"
+    "  STR           r1,[r2,#0x00]     \n"
+
+    /* pop registers r4-r11 and EXC_RETURN */
+    "  POP           {r4-r11,lr}       \n"
+
+    /* s16-s31 so se a thread voltar com frame estendido */
+    "  TST           lr,#0x10          \n"
+    "  IT            EQ                \n"
+    "  VLDMIAEQ      sp!,{s16-s31}     \n"
+
+    /* __enable_irq(); */
+    "  CPSIE         I                 \n"
+
+    /* return to the next thread */
+    "  BX            lr                \n"
+    );
+}
+
+#endif /* MIROS_PORT_POSIX */
@@ -0,0 +1,70 @@
+/*
+ * pid.cpp
+ *
+ * Calculo dos coeficientes discretos do PID (pid.h). Roda so na
+ * configuracao ou na troca de ganhos; o passo do controlador e inline.
+ */
+
+#include <cstdint>
+#include "pid.h"
+
+void pidTuneF(PidF *me, PidConfig const *cfg) {
+	me->cp = cfg->kp;
+	me->ci = cfg->ki * cfg->ts;
+	me->cd = cfg->kd / cfg->ts;
+	me->outMin = cfg->outMin;
+	me->outMax = cfg->outMax;
+}
+
+void pidInitF(PidF *me, PidConfig const *cfg) {
+	pidTuneF(me, cfg);
+	me->integ = 0.0f;
+	me->ePrev = 0.0f;
+}
+
+int32_t pidToQ31(float x, float scale) {
+	float v = (x / scale) * 2147483648.0f;
+	if (v >= 2147483648.0f) {
+		return INT32_MAX;
+	}
+	if (v <= -2147483648.0f) {
+		return INT32_MIN;
+	}
+	return (int32_t)(v + ((v >= 0.0f) ? 0.5f : -0.5f));
+}
+
+static float pidAbs(float x) {
+	return (x < 0.0f) ? -x : x;
+}
+
+void pidTuneQ31(PidQ31 *me, PidConfig const *cfg, float inScale, float outScale) {
+	/* ganhos normalizados: saida/outScale por erro/inScale */
+	float k = inScale / outScale;
+	float cp = cfg->kp * k;
+	float ci = cfg->ki * cfg->ts * k;
+	float cd = cfg->kd / cfg->ts * k;
+
+	/* menor shift que deixa o maior coeficiente abaixo de 1 */
+	float m = pidAbs(cp);
+	m = (pidAbs(ci) > m) ? pidAbs(ci) : m;
+	m = (pidAbs(cd) > m) ? pidAbs(cd) : m;
+	uint8_t shift = 0U;
+	float range = 1.0f;
+	while (m >= range && shift < 30U) {
+		shift++;
+		range *= 2.0f;
+	}
+
+	me->shift = shift;
+	me->cp = pidToQ31(cp, range);
+	me->ci = pidToQ31(ci, range);
+	me->cd = pidToQ31(cd, range);
+	me->outMin = pidToQ31(cfg->outMin, outScale);
+	me->outMax = pidToQ31(cfg->outMax, outScale);
+}
+
+void pidInitQ31(PidQ31 *me, PidConfig const *cfg, float inScale, float outScale) {
+	pidTuneQ31(me, cfg, inScale, outScale);
+	me->integ = 0;
+	me->ePrev = 0;
+}
@@ -22,6 +22,8 @@
 #include "stm32g4xx_it.h"
 
 #include "miros.h"
+#include "miros_trace.h"
+#include "miros_bench.h"
 
 /******************************************************************************/
 /*           Cortex-M4 Processor Interruption and Exception Handlers          */
@@ -109,11 +111,19 @@ void DebugMon_Handler(void)
   */
 void SysTick_Handler(void)
 {
+  OS_TRACE_ISR_ENTER();
   HAL_IncTick();
+#ifdef MIROS_BENCH_SUITE
+  uint32_t start = DWT->CYCCNT;
   rtos::OS_tick();
+  rtos::OS_benchTickSample(DWT->CYCCNT - start);
+#else
+  rtos::OS_tick();
+#endif
   __disable_irq();
   rtos::OS_sched();
   __enable_irq();
+  OS_TRACE_ISR_EXIT();
 }
 
 /******************************************************************************/
@@ -187,6 +197,7 @@ volatile uint8_t buttonEvent = 0;     // flag para indicar clique detectado
 
 void EXTI15_10_IRQHandler(void)
 {
+	OS_TRACE_ISR_ENTER();
 
 	// pra testar com stm
 	HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_13);
@@ -208,6 +219,7 @@ void EXTI15_10_IRQHandler(void)
 	    }
 	            }
 	        }*/
+	OS_TRACE_ISR_EXIT();
 }
 
 
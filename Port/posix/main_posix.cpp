@@ -0,0 +1,95 @@
+/*
+ * main_posix.cpp
+ *
+ * O pipeline do firmware (controle.cpp: LerSensor -> CalculoPid ->
+ * SetaVelocidade) rodando no porte POSIX, com o sensor e o ventilador
+ * trocados por uma planta simulada e o tempo de CPU por OS_portBurnUs().
+ *
+ *   ./miros_sim [segundos simulados] [trace.bin]
+ *
+ * Ao fim imprime perdas, pior tempo de execucao e os histogramas de
+ * cada tarefa, e quantas vezes mais rapido que o tempo real a
+ * simulacao rodou. O trace pode ser lido com o miros_trace.py.
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include "miros.h"
+#include "miros_port.h"
+#include "controle.h"
+
+static uint8_t stack_idleThread[64 * 1024];
+static uint8_t stack_LerSensor[64 * 1024];
+static uint8_t stack_CalculoPid[64 * 1024];
+static uint8_t stack_SetaVelocidade[64 * 1024];
+
+/* planta: a bola sobe com o ventilador acima do ponto de equilibrio */
+static double posicao = 500.0; /* mm ate o sensor */
+static double duty = 61.0;
+
+uint16_t controleLeSensor(void) {
+	/* a medida do VL53L0X leva 20 a 30 ms de polling */
+	rtos::OS_portBurnUs(20000U + (uint32_t)(rand() % 10000));
+	posicao -= (duty - 61.0) * 0.5;
+	if (posicao < 20.0) {
+		posicao = 20.0;
+	}
+	if (posicao > 950.0) {
+		posicao = 950.0;
+	}
+	return (uint16_t)posicao;
+}
+
+void controleAplicaDuty(float d) {
+	duty = d;
+	rtos::OS_portBurnUs(40U);
+}
+
+static void botaoIdle(void) {
+	static uint64_t proximo = 10U * rtos::TICKS_PER_SEC;
+	if (rtos::OS_getTime() >= proximo) {
+		proximo += 10U * rtos::TICKS_PER_SEC;
+		rtos::OS_portIrq(40U, &controleBotao); /* botao: EXTI15_10 */
+	}
+}
+
+static void imprimeTarefa(char const *nome, rtos::OSPeriodicTask const *pt) {
+	printf("%-15s misses=%lu skipped=%lu execMax=%lu ciclos\n", nome,
+			(unsigned long)pt->misses, (unsigned long)pt->skipped,
+			(unsigned long)pt->execMax);
+}
+
+int main(int argc, char *argv[]) {
+	uint32_t segundos = (argc > 1) ? (uint32_t)atoi(argv[1]) : 60U;
+	if (argc > 2 && !rtos::OS_portTraceOpen(argv[2])) {
+		perror(argv[2]);
+		return 1;
+	}
+
+	rtos::OS_init(stack_idleThread, sizeof(stack_idleThread));
+	controleStart(stack_LerSensor, sizeof(stack_LerSensor),
+			stack_CalculoPid, sizeof(stack_CalculoPid),
+			stack_SetaVelocidade, sizeof(stack_SetaVelocidade));
+
+	/* o botao e apertado a cada 10 s simulados */
+	rtos::OS_portStopAt((uint64_t)segundos * rtos::TICKS_PER_SEC);
+	rtos::OS_portSetIdleHook(&botaoIdle);
+
+	timespec t0, t1;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	rtos::OS_run();
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+
+	double real = (double)(t1.tv_sec - t0.tv_sec) + (double)(t1.tv_nsec - t0.tv_nsec) * 1e-9;
+	printf("%lu s simulados em %.3f s (%.0fx tempo real), posicao final %.0f mm\n",
+			(unsigned long)segundos, real, (double)segundos / real, posicao);
+	imprimeTarefa("LerSensor", &threadLerSensor);
+	imprimeTarefa("CalculoPid", &threadCalculoPid);
+	imprimeTarefa("SetaVelocidade", &threadSetaVelocidade);
+#if MIROS_CFG_STATS
+	rtos::OS_statsDump();
+#endif
+	return 0;
+}
@@ -0,0 +1,250 @@
+/*
+ * miros_port_posix.cpp
+ *
+ * Porte POSIX do MiROS. Cada thread e uma fibra ucontext; um unico
+ * processo executa uma fibra por vez, como o nucleo do alvo.
+ *
+ * O tempo e simulado em ciclos (OS_portCycles): so avanca quando uma
+ * thread chama OS_portBurn() ou quando a idle espera o proximo tick.
+ * A cada SystemCoreClock / TICKS_PER_SEC ciclos o SysTick simulado fica
+ * pendente e roda OS_tick() + OS_sched() assim que as interrupcoes
+ * permitirem. O PendSV e a troca de fibra com swapcontext().
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ucontext.h>
+#include "miros.h"
+#include "miros_port.h"
+#include "miros_trace.h"
+#include "qassert.h"
+
+Q_DEFINE_THIS_FILE
+
+uint32_t SystemCoreClock = 16000000U; /* o mesmo HSI do alvo */
+
+namespace rtos {
+
+extern uint64_t volatile OS_time; /* miros.cpp */
+
+uint32_t OS_portPrimask;
+uint32_t OS_portIpsr;
+bool OS_portPendSV;
+bool OS_portTickPending;
+uint64_t OS_portCycles;
+
+OSPortDwt OS_portDwt;
+OSPortCoreDebug OS_portCoreDebug;
+OSPortItm OS_portItm;
+
+typedef struct {
+	ucontext_t ctx;
+	OSThreadHandler entry;
+	void *stkSto;
+	uint32_t stkSize;
+} OSPortFiber;
+
+static OSPortFiber OS_portFibers[OS_MAX_THREADS + 1];
+static ucontext_t OS_portMain; /* contexto de OS_run() */
+static uint64_t OS_portNextTick; /* ciclo do proximo SysTick */
+static uint64_t OS_portStopTick = UINT64_MAX;
+static bool OS_portStopped;
+static FILE *OS_portTrace;
+static void (*OS_portIdleHook)(void);
+
+static const uint16_t OS_PORT_SYSTICK = 15U; /* numero da excecao */
+
+void OS_portInit(void) {
+}
+
+/* primeira coisa que uma fibra executa: sai do "PendSV" com as
+* interrupcoes habilitadas, como o CPSIE antes do BX lr
+*/
+static void OS_portFiberEntry(int index) {
+	OS_portPrimask = 0U;
+	OS_portPoll();
+	OS_portFibers[index].entry();
+}
+
+static void OS_portFiberMake(OSPortFiber *f, uint16_t index) {
+	getcontext(&f->ctx);
+	f->ctx.uc_stack.ss_sp = f->stkSto;
+	f->ctx.uc_stack.ss_size = f->stkSize;
+	f->ctx.uc_link = (ucontext_t *)0; /* thread que retorna encerra o processo */
+	makecontext(&f->ctx, (void (*)())&OS_portFiberEntry, 1, (int)index);
+}
+
+void OS_portThreadInit(OSThread *me, OSThreadHandler entry,
+    void *stkSto, uint32_t stkSize) {
+	OSPortFiber *f = &OS_portFibers[me->index];
+	/* pintada como no alvo; a marca d'agua aqui e a da pilha do host */
+	uint32_t *base = (uint32_t *)((((uintptr_t)stkSto + 7U) / 8U) * 8U);
+	for (uint32_t *p = base; p < (uint32_t *)((uint8_t *)stkSto + stkSize); p++) {
+		*p = OS_STACK_PAINT;
+	}
+	me->stkBase = base;
+	f->entry = entry;
+	f->stkSto = stkSto;
+	f->stkSize = stkSize;
+	OS_portFiberMake(f, me->index);
+	me->sp = f;
+	me->stkTop = (uint8_t *)stkSto + stkSize;
+}
+
+void OS_portThreadRestart(OSThread *me) {
+	OSPortFiber *f = (OSPortFiber *)me->sp;
+	f->entry = &osPeriodicWrapper;
+	OS_portFiberMake(f, me->index);
+}
+
+/* o PendSV: chamado com OS_portPrimask = 1 */
+static void OS_portSwitch(void) {
+	OS_portPendSV = false;
+	OSThread *prev = OS_curr;
+	bool restart = false;
+	if (prev != (OSThread *)0) {
+		restart = prev->restart;
+		OS_switchHook(); /* refaz a fibra de prev se restart */
+	}
+	OSThread *next = OS_next;
+	OS_curr = next;
+	OSPortFiber *to = (OSPortFiber *)next->sp;
+	if (prev == (OSThread *)0) {
+		/* primeira troca: OS_run() so volta em OS_portStopAt */
+		swapcontext(&OS_portMain, &to->ctx);
+	}
+	else if (restart) {
+		/* o contexto atual de prev e descartado */
+		setcontext(&to->ctx);
+	}
+	else if (prev != next) {
+		swapcontext(&((OSPortFiber *)prev->sp)->ctx, &to->ctx);
+	}
+}
+
+static void OS_portTickIsr(void) {
+	OS_portIpsr = OS_PORT_SYSTICK;
+	OS_TRACE_ISR_ENTER();
+	OS_tick();
+	__disable_irq();
+	OS_sched();
+	__enable_irq();
+	OS_TRACE_ISR_EXIT();
+	OS_portIpsr = 0U;
+	if (OS_time >= OS_portStopTick) {
+		OS_portStopped = true;
+		OS_portPrimask = 1U;
+		setcontext(&OS_portMain);
+	}
+}
+
+void OS_portService(void) {
+	while (!OS_portStopped && OS_portPrimask == 0U && OS_portIpsr == 0U) {
+		if (OS_portTickPending) {
+			OS_portTickPending = false;
+			OS_portTickIsr();
+		}
+		else if (OS_portPendSV) {
+			OS_portPrimask = 1U;
+			OS_portSwitch();
+			OS_portPrimask = 0U;
+		}
+		else {
+			break;
+		}
+	}
+}
+
+void OS_portBurn(uint32_t cycles) {
+	uint64_t left = cycles;
+	while (left != 0U) {
+		uint64_t toTick = OS_portNextTick - OS_portCycles;
+		if (left < toTick) {
+			OS_portCycles += left;
+			return;
+		}
+		/* o SysTick dispara no meio do trabalho; o resto continua
+		* quando esta thread voltar a rodar
+		*/
+		OS_portCycles = OS_portNextTick;
+		OS_portNextTick += SystemCoreClock / TICKS_PER_SEC;
+		left -= toTick;
+		OS_portTickPending = true;
+		OS_portPoll();
+	}
+}
+
+void OS_portBurnUs(uint32_t us) {
+	OS_portBurn((uint32_t)((uint64_t)us * SystemCoreClock / 1000000U));
+}
+
+void OS_portStopAt(uint64_t ticks) {
+	OS_portStopTick = ticks;
+}
+
+void OS_portSetIdleHook(void (*hook)(void)) {
+	OS_portIdleHook = hook;
+}
+
+void OS_portIrq(uint16_t irqn, void (*isr)(void)) {
+	Q_REQUIRE(OS_portPrimask == 0U && OS_portIpsr == 0U);
+	OS_portIpsr = irqn + 16U;
+	OS_TRACE_ISR_ENTER();
+	isr();
+	OS_TRACE_ISR_EXIT();
+	OS_portIpsr = 0U;
+	OS_portPoll();
+}
+
+bool OS_portTraceOpen(char const *path) {
+	OS_portTrace = fopen(path, "wb");
+	if (OS_portTrace == (FILE *)0) {
+		return false;
+	}
+	/* pacote de sincronizacao e ITM habilitado como faria o probe */
+	static const uint8_t sync[6] = { 0U, 0U, 0U, 0U, 0U, 0x80U };
+	fwrite(sync, 1U, sizeof(sync), OS_portTrace);
+	OS_portItm.TCR |= ITM_TCR_ITMENA_Msk;
+	return true;
+}
+
+OSPortStim::Word &OSPortStim::Word::operator=(uint32_t v) {
+	uint32_t port = (uint32_t)((OSPortStim const *)this - &OS_portItm.PORT[0]);
+	if (OS_portTrace != (FILE *)0) {
+		uint8_t pkt[5] = { (uint8_t)((port << 3) | 3U),
+				(uint8_t)v, (uint8_t)(v >> 8), (uint8_t)(v >> 16), (uint8_t)(v >> 24) };
+		fwrite(pkt, 1U, sizeof(pkt), OS_portTrace);
+	}
+	return *this;
+}
+
+/* callbacks da placa */
+void OS_onStartup(void) {
+	OS_portNextTick = OS_portCycles + SystemCoreClock / TICKS_PER_SEC;
+}
+
+/* a idle "dorme" ate o proximo tick */
+void OS_onIdle(void) {
+	if (OS_portIdleHook != (void (*)(void))0) {
+		OS_portIdleHook();
+	}
+	OS_portBurn((uint32_t)(OS_portNextTick - OS_portCycles));
+}
+
+}
+
+uint32_t ITM_SendChar(uint32_t ch) {
+	putchar((int)ch);
+	return ch;
+}
+
+void HardFault_Handler(void) {
+	fprintf(stderr, "HardFault\n");
+	abort();
+}
+
+void Q_onAssert(char const *module, int loc) {
+	fprintf(stderr, "assert: %s:%d\n", module, loc);
+	abort();
+}
@@ -0,0 +1,151 @@
+/*
+ * miros_port_posix.h
+ *
+ * Porte POSIX do MiROS: as threads sao fibras ucontext num unico
+ * processo e o tempo e simulado. Este arquivo faz o papel do
+ * stm32g4xx.h para o kernel: intrinsecos do CMSIS e os registradores
+ * do DWT e do ITM que o kernel usa, em cima do estado da simulacao.
+ *
+ * PRIMASK e PendSV sao emulados: a troca de contexto pendente e o tick
+ * pendente so acontecem quando as interrupcoes voltam a ficar
+ * habilitadas fora de uma ISR, como no Cortex-M.
+ */
+
+#ifndef MIROS_PORT_POSIX_H_
+#define MIROS_PORT_POSIX_H_
+
+#include <cstdint>
+#include "miros_config.h"
+
+#if MIROS_CFG_TICKLESS
+#error "o porte POSIX nao usa o SysTick; o idle ja pula direto para o proximo tick"
+#endif
+
+namespace rtos {
+
+extern uint32_t OS_portPrimask; /* 1 = interrupcoes desabilitadas */
+extern uint32_t OS_portIpsr; /* excecao em execucao, 0 em thread */
+extern bool OS_portPendSV; /* troca de contexto pendente */
+extern bool OS_portTickPending; /* SysTick pendente */
+extern uint64_t OS_portCycles; /* ciclos simulados desde a partida */
+
+/* executa o que estiver pendente se as interrupcoes permitirem */
+void OS_portService(void);
+
+static inline void OS_portPoll(void) {
+	if ((OS_portPendSV || OS_portTickPending)
+			&& OS_portPrimask == 0U && OS_portIpsr == 0U) {
+		OS_portService();
+	}
+}
+
+static inline void OS_portPendSwitch(void) {
+	OS_portPendSV = true;
+}
+
+/* API da simulacao */
+
+/* a thread atual executa por 'cycles' ciclos de CPU simulados; ticks
+* e preempcoes acontecem no meio, como no alvo
+*/
+void OS_portBurn(uint32_t cycles);
+void OS_portBurnUs(uint32_t us);
+
+/* OS_run() retorna quando OS_time chegar a 'ticks' */
+void OS_portStopAt(uint64_t ticks);
+
+/* executa 'isr' como a interrupcao 'irqn' agora (tail-chaining com o
+* PendSV na saida); chamar de uma thread com interrupcoes habilitadas
+*/
+void OS_portIrq(uint16_t irqn, void (*isr)(void));
+
+/* chamado pela idle antes de esperar cada tick; bom lugar para
+* injetar interrupcoes com OS_portIrq()
+*/
+void OS_portSetIdleHook(void (*hook)(void));
+
+/* grava o trace do ITM num arquivo no formato do SWO, para o
+* miros_trace.py; chamar antes de OS_run()
+*/
+bool OS_portTraceOpen(char const *path);
+
+/* registradores simulados */
+struct OSPortCycCnt {
+	operator uint32_t() const { return (uint32_t)OS_portCycles; }
+};
+
+struct OSPortDwt {
+	uint32_t CTRL;
+	OSPortCycCnt CYCCNT;
+};
+
+struct OSPortCoreDebug {
+	uint32_t DEMCR;
+};
+
+/* escrita numa porta de estimulo = pacote ITM no arquivo de trace */
+struct OSPortStim {
+	struct Word {
+		operator uint32_t() const { return 1U; } /* FIFO sempre livre */
+		Word &operator=(uint32_t v);
+	} u32;
+};
+
+struct OSPortItm {
+	OSPortStim PORT[32];
+	uint32_t TER;
+	uint32_t TCR;
+	uint32_t LAR;
+};
+
+extern OSPortDwt OS_portDwt;
+extern OSPortCoreDebug OS_portCoreDebug;
+extern OSPortItm OS_portItm;
+
+}
+
+#define DWT (&::rtos::OS_portDwt)
+#define CoreDebug (&::rtos::OS_portCoreDebug)
+#define ITM (&::rtos::OS_portItm)
+#define CoreDebug_DEMCR_TRCENA_Msk (1UL << 24)
+#define DWT_CTRL_CYCCNTENA_Msk (1UL)
+#define ITM_TCR_ITMENA_Msk (1UL)
+
+extern uint32_t SystemCoreClock;
+
+static inline void SystemCoreClockUpdate(void) {
+}
+
+static inline void __disable_irq(void) {
+	rtos::OS_portPrimask = 1U;
+}
+
+static inline void __enable_irq(void) {
+	rtos::OS_portPrimask = 0U;
+	rtos::OS_portPoll();
+}
+
+static inline uint32_t __get_PRIMASK(void) {
+	return rtos::OS_portPrimask;
+}
+
+static inline void __set_PRIMASK(uint32_t primask) {
+	rtos::OS_portPrimask = primask;
+	rtos::OS_portPoll();
+}
+
+static inline uint32_t __get_IPSR(void) {
+	return rtos::OS_portIpsr;
+}
+
+static inline uint32_t __CLZ(uint32_t x) {
+	return (x == 0U) ? 32U : (uint32_t)__builtin_clz(x);
+}
+
+static inline void __WFI(void) {
+}
+
+/* texto da porta 0 (OS_statsDump) vai para a saida padrao */
+uint32_t ITM_SendChar(uint32_t ch);
+
+#endif /* MIROS_PORT_POSIX_H_ */
@@ -0,0 +1,90 @@
+/*
+ * test_budget.cpp
+ *
+ * Orcamento de execucao com SUSPEND e ABORT. Duas tarefas de T 10 e WCET
+ * de 2 ticks, defasadas em 5 ticks para nao interferirem; o primeiro job
+ * de cada uma quer 4 ticks de CPU e os seguintes 1. O tick que encontra
+ * 3 ticks gastos acusa o estouro:
+ *  - SUSPEND (perda com SKIP): o job para no tick 3, volta na liberacao
+ *    do tick 10 com orcamento novo e termina em 11; essa liberacao conta
+ *    como perda e e descartada.
+ *  - ABORT: o job e descartado no tick 8 e a thread espera a liberacao
+ *    do tick 15, sem perda de deadline.
+ */
+
+#include <cstdint>
+#include "miros.h"
+#include "miros_port.h"
+#include "qassert.h"
+#include "teste.h"
+
+#define TICK (SystemCoreClock / rtos::TICKS_PER_SEC) /* ciclos */
+
+static uint8_t stack_idle[64 * 1024];
+static uint8_t stack_susp[64 * 1024];
+static uint8_t stack_abort[64 * 1024];
+static rtos::OSPeriodicTask susp;
+static rtos::OSPeriodicTask abortada;
+
+typedef struct {
+	uint64_t inicio[8]; /* ticks */
+	uint64_t fim[8]; /* ciclos */
+	uint32_t n;
+	uint32_t fins;
+} Jobs;
+
+static Jobs jobsSusp;
+static Jobs jobsAbort;
+
+static void job(Jobs *j) {
+	if (j->n < Q_DIM(j->inicio)) {
+		j->inicio[j->n] = rtos::OS_getTime();
+	}
+	j->n++;
+	rtos::OS_portBurn((j->n == 1U) ? TICK * 4U : TICK);
+	if (j->fins < Q_DIM(j->fim)) {
+		j->fim[j->fins] = rtos::OS_portCycles;
+	}
+	j->fins++;
+}
+
+static void tarefaSusp() {
+	job(&jobsSusp);
+}
+
+static void tarefaAbort() {
+	job(&jobsAbort);
+}
+
+int main(void) {
+	rtos::OS_init(stack_idle, sizeof(stack_idle));
+	CHECK(rtos::OSPeriodicTask_start(&susp, &tarefaSusp, stack_susp, sizeof(stack_susp),
+			10U, 20000U));
+	CHECK(rtos::OSPeriodicTask_start(&abortada, &tarefaAbort, stack_abort, sizeof(stack_abort),
+			10U, 20000U, 5U));
+	rtos::OSPeriodicTask_setBudgetAction(&susp, rtos::OS_BUDGET_SUSPEND);
+	rtos::OSPeriodicTask_setMissPolicy(&susp, rtos::OS_MISS_SKIP);
+	rtos::OSPeriodicTask_setBudgetAction(&abortada, rtos::OS_BUDGET_ABORT);
+	rtos::OS_portStopAt(48U);
+	rtos::OS_run();
+
+	/* SUSPEND: 3 ticks, suspenso de 3 a 10, mais 1 tick */
+	CHECK(susp.budgetOverruns == 1U);
+	CHECK(susp.misses == 1U && susp.skipped == 1U && susp.aborted == 0U);
+	CHECK(jobsSusp.n == 4U && jobsSusp.fins == 4U);
+	CHECK(jobsSusp.fim[0] == TICK * 11U);
+	CHECK(jobsSusp.inicio[1] == 20U && jobsSusp.fim[1] == TICK * 21U);
+
+	/* ABORT: o primeiro job nunca termina, os seguintes seguem a fase */
+	CHECK(abortada.budgetOverruns == 1U);
+	CHECK(abortada.aborted == 1U && abortada.misses == 0U);
+	CHECK(jobsAbort.n == 5U && jobsAbort.fins == 4U);
+	for (uint32_t k = 0U; k < 5U; k++) {
+		CHECK(jobsAbort.inicio[k] == 10U * k + 5U);
+	}
+	CHECK(jobsAbort.fim[0] == TICK * 16U);
+
+	/* o tempo suspenso nao conta como execucao */
+	CHECK(susp.execMax <= TICK * 3U + TICK / 100U);
+	return testeFim("test_budget");
+}
@@ -0,0 +1,104 @@
+/*
+ * test_jobheap.cpp
+ *
+ * Ordem de execucao dos jobs aperiodicos. O OSJobHeap sozinho contra uma
+ * ordenacao estavel de referencia (deadline, depois chegada; sem deadline
+ * por ultimo), com entradas e saidas intercaladas e o heap cheio. Depois
+ * jobs postados fora de ordem na fila do kernel, que a idle tem que
+ * executar por deadline.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include "miros.h"
+#include "miros_port.h"
+#include "jobheap.h"
+#include "qassert.h"
+#include "teste.h"
+
+#define NUM_JOBS 200U
+
+static rtos::OSJobHeap<NUM_JOBS> heap;
+static rtos::OSAperiodicTask jobs[NUM_JOBS];
+static rtos::OSAperiodicTask *referencia[NUM_JOBS];
+static uint32_t seed = 12345U;
+
+/* poucos valores distintos, para ter empates; um em cada oito sem deadline */
+static uint64_t sorteiaDeadline(void) {
+	seed = seed * 1664525U + 1013904223U;
+	if ((seed >> 29) == 0U) {
+		return rtos::OS_NO_DEADLINE;
+	}
+	return (seed >> 16) % 16U;
+}
+
+static uint8_t stack_idle[64 * 1024];
+static rtos::OSAperiodicTask kJobs[6];
+static char ordem[8];
+static uint32_t numOrdem;
+
+static void job(void *arg) {
+	if (numOrdem < Q_DIM(ordem) - 1U) {
+		ordem[numOrdem++] = *(char const *)arg;
+	}
+}
+
+int main(void) {
+	/* heap cheio contra a referencia */
+	for (uint32_t i = 0U; i < NUM_JOBS; i++) {
+		jobs[i].deadline = sorteiaDeadline();
+		CHECK(heap.push(&jobs[i]));
+		referencia[i] = &jobs[i];
+	}
+	rtos::OSAperiodicTask extra = jobs[0];
+	CHECK(heap.full() && !heap.push(&extra));
+	std::stable_sort(referencia, referencia + NUM_JOBS,
+			[](rtos::OSAperiodicTask const *a, rtos::OSAperiodicTask const *b) {
+				return a->deadline < b->deadline;
+			});
+	bool emOrdem = true;
+	for (uint32_t i = 0U; i < NUM_JOBS; i++) {
+		emOrdem = emOrdem && heap.pop() == referencia[i];
+	}
+	CHECK(emOrdem);
+	CHECK(heap.empty() && heap.pop() == (rtos::OSAperiodicTask *)0);
+
+	/* intercalado: o que sai e sempre o menor (deadline, chegada) presente */
+	uint64_t ultimo = 0U;
+	uint32_t dentro = 0U;
+	emOrdem = true;
+	for (uint32_t i = 0U; i < NUM_JOBS; i++) {
+		jobs[i].deadline = 100U + i / 4U; /* nunca abaixo do que ja saiu */
+		CHECK(heap.push(&jobs[i]));
+		dentro++;
+		if ((i % 3U) == 2U) {
+			rtos::OSAperiodicTask *j = heap.pop();
+			emOrdem = emOrdem && j->deadline >= ultimo;
+			ultimo = j->deadline;
+			dentro--;
+		}
+	}
+	while (!heap.empty()) {
+		rtos::OSAperiodicTask *j = heap.pop();
+		emOrdem = emOrdem && j->deadline >= ultimo;
+		ultimo = j->deadline;
+		dentro--;
+	}
+	CHECK(emOrdem && dentro == 0U);
+
+	/* na fila do kernel: postados fora de ordem, executados por deadline */
+	static char const nomes[] = "ABCDEF";
+	static uint32_t const deadlines[] = { 0U, 30U, 10U, 0U, 10U, 20U }; /* 0 = sem */
+	rtos::OS_init(stack_idle, sizeof(stack_idle));
+	for (uint32_t k = 0U; k < Q_DIM(kJobs); k++) {
+		CHECK(rtos::OSAperiodicTask_start(&kJobs[k], &job, (void *)&nomes[k], deadlines[k]));
+	}
+	rtos::AperiodicServerStart();
+	rtos::OS_portStopAt(5U);
+	rtos::OS_run();
+
+	CHECK(numOrdem == Q_DIM(kJobs));
+	CHECK(ordem[0] == 'C' && ordem[1] == 'E' && ordem[2] == 'F');
+	CHECK(ordem[3] == 'B' && ordem[4] == 'A' && ordem[5] == 'D');
+	return testeFim("test_jobheap");
+}
@@ -0,0 +1,97 @@
+/*
+ * test_miss.cpp
+ *
+ * Politicas de perda de deadline, compilado com a fila de timeouts e com
+ * a tabela de liberacoes. Tres tarefas de periodo 10 ticks, uma por
+ * politica; o primeiro job de cada uma fica bloqueado 15 ticks num
+ * OS_delay (sem usar CPU, entao elas nao interferem entre si) e os
+ * seguintes terminam na hora. A perda do primeiro job tem que ser contada
+ * uma vez so, na liberacao do tick 10, e custar no maximo um job. Nos
+ * dois modos deadline e nextRelease da tarefa acompanham as liberacoes.
+ */
+
+#include <cstdint>
+#include "miros.h"
+#include "miros_port.h"
+#include "qassert.h"
+#include "teste.h"
+
+static uint8_t stack_idle[64 * 1024];
+static uint8_t stack_skip[64 * 1024];
+static uint8_t stack_late[64 * 1024];
+static uint8_t stack_abort[64 * 1024];
+static rtos::OSPeriodicTask skip;
+static rtos::OSPeriodicTask late;
+static rtos::OSPeriodicTask abortada;
+
+/* inicio de cada job, em ticks */
+typedef struct {
+	uint64_t inicio[16];
+	uint32_t n;
+} Jobs;
+
+static Jobs jobsSkip;
+static Jobs jobsLate;
+static Jobs jobsAbort;
+
+static void job(Jobs *j) {
+	if (j->n < Q_DIM(j->inicio)) {
+		j->inicio[j->n] = rtos::OS_getTime();
+	}
+	j->n++;
+	if (j->n == 1U) {
+		rtos::OS_delay(15U); /* so o primeiro passa do deadline */
+	}
+}
+
+static void tarefaSkip() {
+	job(&jobsSkip);
+}
+
+static void tarefaLate() {
+	job(&jobsLate);
+}
+
+static void tarefaAbort() {
+	job(&jobsAbort);
+}
+
+int main(void) {
+	rtos::OS_init(stack_idle, sizeof(stack_idle));
+	CHECK(rtos::OSPeriodicTask_start(&skip, &tarefaSkip, stack_skip, sizeof(stack_skip), 10U));
+	CHECK(rtos::OSPeriodicTask_start(&late, &tarefaLate, stack_late, sizeof(stack_late), 10U));
+	CHECK(rtos::OSPeriodicTask_start(&abortada, &tarefaAbort, stack_abort, sizeof(stack_abort),
+			10U));
+	rtos::OSPeriodicTask_setMissPolicy(&skip, rtos::OS_MISS_SKIP);
+	rtos::OSPeriodicTask_setMissPolicy(&late, rtos::OS_MISS_RUN_LATE);
+	rtos::OSPeriodicTask_setMissPolicy(&abortada, rtos::OS_MISS_ABORT);
+	rtos::OS_portStopAt(95U);
+	rtos::OS_run();
+
+	/* SKIP: so a liberacao do tick 10 some; a do 20 executa */
+	CHECK(skip.misses == 1U && skip.skipped == 1U && skip.aborted == 0U);
+	CHECK(jobsSkip.n == 9U);
+	CHECK(jobsSkip.inicio[1] == 20U);
+
+	/* RUN_LATE: o job do tick 10 comeca quando o primeiro termina */
+	CHECK(late.misses == 1U && late.skipped == 0U && late.aborted == 0U);
+	CHECK(jobsLate.n == 10U);
+	CHECK(jobsLate.inicio[1] == 15U);
+	CHECK(jobsLate.inicio[2] == 20U);
+
+	/* ABORT: o primeiro job e descartado e o do tick 10 entra no lugar */
+	CHECK(abortada.misses == 1U && abortada.skipped == 0U && abortada.aborted == 1U);
+	CHECK(jobsAbort.n == 10U);
+	CHECK(jobsAbort.inicio[1] == 10U);
+
+	/* ultima liberacao no tick 90 */
+	CHECK(skip.deadline == 100U && skip.nextRelease == 100U);
+	CHECK(late.deadline == 100U && late.nextRelease == 100U);
+	CHECK(abortada.deadline == 100U && abortada.nextRelease == 100U);
+
+#if MIROS_CFG_RELEASE_TABLE
+	return testeFim("test_miss (tabela)");
+#else
+	return testeFim("test_miss (fila)");
+#endif
+}
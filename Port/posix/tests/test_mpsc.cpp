@@ -0,0 +1,115 @@
+/*
+ * test_mpsc.cpp
+ *
+ * Fila sem trava dos jobs aperiodicos (mpscqueue.h). Primeiro o
+ * container sozinho: capacidade, ordem FIFO e volta do indice; depois
+ * quatro threads do host produzindo ao mesmo tempo que o consumidor, que
+ * tem que receber tudo, uma vez so e na ordem de cada produtor. Por fim
+ * a fila do kernel: 32 jobs enfileirados antes de OS_run enchem o anel,
+ * o 33o e recusado, e um job postado por uma ISR no meio da execucao vai
+ * para o fim.
+ */
+
+#include <cstdint>
+#include <thread>
+#include "miros.h"
+#include "miros_port.h"
+#include "mpscqueue.h"
+#include "qassert.h"
+#include "teste.h"
+
+#define PRODUTORES 4U
+#define POR_PRODUTOR 20000U
+
+static rtos::OSMpscQueue<uint32_t, 64U> filaHost;
+
+static void produtor(uint32_t p) {
+	for (uint32_t i = 0U; i < POR_PRODUTOR; i++) {
+		while (!filaHost.push((p << 24) | i)) {
+			std::this_thread::yield(); /* cheia: espera o consumidor */
+		}
+	}
+}
+
+static uint8_t stack_idle[64 * 1024];
+static rtos::OSAperiodicTask jobs[MIROS_CFG_APERIODIC_QUEUE_LEN + 2U];
+static uint32_t ordem[MIROS_CFG_APERIODIC_QUEUE_LEN + 2U];
+static uint32_t numOrdem;
+
+static void job(void *arg);
+
+/* ISR que posta um job com a fila em uso */
+static void isrPosta(void) {
+	CHECK(rtos::OSAperiodicTask_start(&jobs[MIROS_CFG_APERIODIC_QUEUE_LEN + 1U], &job,
+			(void *)(uintptr_t)(MIROS_CFG_APERIODIC_QUEUE_LEN + 1U)));
+}
+
+static void job(void *arg) {
+	uint32_t k = (uint32_t)(uintptr_t)arg;
+	if (numOrdem < Q_DIM(ordem)) {
+		ordem[numOrdem] = k;
+	}
+	numOrdem++;
+	if (k == 0U) {
+		rtos::OS_portIrq(1U, &isrPosta);
+	}
+}
+
+int main(void) {
+	/* capacidade e FIFO, dando varias voltas no anel */
+	rtos::OSMpscQueue<uint32_t, 8U> fila;
+	uint32_t v;
+	CHECK(fila.empty() && !fila.pop(v));
+	for (uint32_t volta = 0U; volta < 100U; volta++) {
+		for (uint32_t i = 0U; i < 8U; i++) {
+			CHECK(fila.push(volta * 8U + i));
+		}
+		CHECK(!fila.push(0U));
+		CHECK(fila.size() == 8U);
+		for (uint32_t i = 0U; i < 8U; i++) {
+			CHECK(fila.pop(v) && v == volta * 8U + i);
+		}
+		CHECK(fila.empty() && !fila.pop(v));
+	}
+
+	/* produtores concorrentes de verdade */
+	std::thread threads[PRODUTORES];
+	for (uint32_t p = 0U; p < PRODUTORES; p++) {
+		threads[p] = std::thread(produtor, p);
+	}
+	uint32_t proximo[PRODUTORES] = { 0U };
+	uint32_t recebidos = 0U;
+	bool emOrdem = true;
+	while (recebidos < PRODUTORES * POR_PRODUTOR) {
+		if (filaHost.pop(v)) {
+			uint32_t p = v >> 24;
+			emOrdem = emOrdem && p < PRODUTORES && (v & 0xFFFFFFU) == proximo[p];
+			if (p < PRODUTORES) {
+				proximo[p]++;
+			}
+			recebidos++;
+		}
+	}
+	for (uint32_t p = 0U; p < PRODUTORES; p++) {
+		threads[p].join();
+	}
+	CHECK(emOrdem);
+	CHECK(filaHost.empty() && !filaHost.pop(v));
+
+	/* fila do kernel */
+	rtos::OS_init(stack_idle, sizeof(stack_idle));
+	for (uint32_t k = 0U; k < MIROS_CFG_APERIODIC_QUEUE_LEN; k++) {
+		CHECK(rtos::OSAperiodicTask_start(&jobs[k], &job, (void *)(uintptr_t)k));
+	}
+	CHECK(!rtos::OSAperiodicTask_start(&jobs[MIROS_CFG_APERIODIC_QUEUE_LEN], &job,
+			(void *)(uintptr_t)MIROS_CFG_APERIODIC_QUEUE_LEN));
+	rtos::AperiodicServerStart();
+	rtos::OS_portStopAt(5U);
+	rtos::OS_run();
+
+	CHECK(numOrdem == MIROS_CFG_APERIODIC_QUEUE_LEN + 1U);
+	for (uint32_t k = 0U; k <= MIROS_CFG_APERIODIC_QUEUE_LEN; k++) {
+		CHECK(ordem[k] == ((k < MIROS_CFG_APERIODIC_QUEUE_LEN) ? k : MIROS_CFG_APERIODIC_QUEUE_LEN + 1U));
+	}
+	return testeFim("test_mpsc");
+}
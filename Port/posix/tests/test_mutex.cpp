@@ -0,0 +1,102 @@
+/*
+ * test_mutex.cpp
+ *
+ * Bloqueio pelo teto do OSMutex, compilado com RM e com EDF (SRP). Baixa
+ * (T 40) e media (T 20, liberada em +2) usam o mutex; alta (T 10,
+ * liberada em +3) nao. A baixa trava no tick 0 e fica 5 ticks na secao
+ * critica. A media, mais prioritaria, so pode comecar quando a baixa
+ * soltar; a alta esta acima do teto e preempta a baixa dentro da secao
+ * critica no tick 3.
+ */
+
+#include <cstdint>
+#include "miros.h"
+#include "miros_port.h"
+#include "qassert.h"
+#include "teste.h"
+
+#define TICK (SystemCoreClock / rtos::TICKS_PER_SEC) /* ciclos */
+
+static uint8_t stack_idle[64 * 1024];
+static uint8_t stack_alta[64 * 1024];
+static uint8_t stack_media[64 * 1024];
+static uint8_t stack_baixa[64 * 1024];
+static rtos::OSPeriodicTask alta;
+static rtos::OSPeriodicTask media;
+static rtos::OSPeriodicTask baixa;
+static rtos::OSMutex mutex;
+
+static bool travado; /* a baixa esta na secao critica */
+
+typedef struct {
+	uint64_t inicio; /* ciclos, primeiro job */
+	bool viuTravado; /* o primeiro job comecou com o mutex travado */
+	uint32_t n;
+} Jobs;
+
+static Jobs jobsAlta;
+static Jobs jobsMedia;
+static uint64_t soltouBaixa;
+static uint64_t fimBaixa;
+
+static void comeca(Jobs *j) {
+	if (j->n == 0U) {
+		j->inicio = rtos::OS_portCycles;
+		j->viuTravado = travado;
+	}
+	j->n++;
+}
+
+static void tarefaAlta() {
+	comeca(&jobsAlta);
+	rtos::OS_portBurn(TICK / 2U);
+}
+
+static void tarefaMedia() {
+	comeca(&jobsMedia);
+	rtos::OSMutex_lock(&mutex);
+	rtos::OS_portBurn(TICK);
+	rtos::OSMutex_unlock(&mutex);
+}
+
+static void tarefaBaixa() {
+	rtos::OSMutex_lock(&mutex);
+	travado = true;
+	rtos::OS_portBurn(TICK * 5U);
+	travado = false;
+	soltouBaixa = rtos::OS_portCycles;
+	rtos::OSMutex_unlock(&mutex);
+	rtos::OS_portBurn(TICK);
+	fimBaixa = rtos::OS_portCycles;
+}
+
+int main(void) {
+	rtos::OS_init(stack_idle, sizeof(stack_idle));
+	CHECK(rtos::OSPeriodicTask_start(&alta, &tarefaAlta, stack_alta, sizeof(stack_alta),
+			10U, 5000U, 3U));
+	CHECK(rtos::OSPeriodicTask_start(&media, &tarefaMedia, stack_media, sizeof(stack_media),
+			20U, 10000U, 2U));
+	CHECK(rtos::OSPeriodicTask_start(&baixa, &tarefaBaixa, stack_baixa, sizeof(stack_baixa),
+			40U, 70000U));
+	rtos::OSMutex_init(&mutex);
+	rtos::OSMutex_addUser(&mutex, &media);
+	rtos::OSMutex_addUser(&mutex, &baixa);
+	rtos::OS_portStopAt(40U);
+	rtos::OS_run();
+
+	/* a alta esta acima do teto: entra na hora, com o mutex travado */
+	CHECK(jobsAlta.inicio == TICK * 3U && jobsAlta.viuTravado);
+	/* a media espera a secao critica, que a alta atrasou meio tick */
+	CHECK(soltouBaixa == TICK * 11U / 2U);
+	CHECK(jobsMedia.inicio == soltouBaixa && !jobsMedia.viuTravado);
+	CHECK(fimBaixa == TICK * 15U / 2U);
+
+	CHECK(jobsAlta.n == 4U && jobsMedia.n == 2U);
+	CHECK(alta.misses == 0U && media.misses == 0U && baixa.misses == 0U);
+	CHECK(mutex.owner == (rtos::OSPeriodicTask *)0);
+#if MIROS_CFG_SCHED_POLICY == MIROS_SCHED_EDF
+	return testeFim("test_mutex (EDF)");
+#else
+	return testeFim("test_mutex (RM)");
+#endif
+}
@@ -0,0 +1,88 @@
+/*
+ * test_offset.cpp
+ *
+ * Fases de liberacao, compilado com a fila de timeouts e com a tabela de
+ * liberacoes. A (T 10), B (T 10, offset 3) e C (T 20, offset 7, D 5):
+ * cada job tem que comecar na sua liberacao defasada, o deadline contar
+ * a partir dela e um job de C que passa de liberacao + D ser acusado
+ * como perda mesmo terminando antes do proximo periodo.
+ */
+
+#include <cstdint>
+#include "miros.h"
+#include "miros_port.h"
+#include "qassert.h"
+#include "teste.h"
+
+#define TICK (SystemCoreClock / rtos::TICKS_PER_SEC) /* ciclos */
+
+static uint8_t stack_idle[64 * 1024];
+static uint8_t stack_a[64 * 1024];
+static uint8_t stack_b[64 * 1024];
+static uint8_t stack_c[64 * 1024];
+static rtos::OSPeriodicTask a;
+static rtos::OSPeriodicTask b;
+static rtos::OSPeriodicTask c;
+
+/* inicio de cada job, em ticks */
+typedef struct {
+	uint64_t inicio[8];
+	uint32_t n;
+} Jobs;
+
+static Jobs jobsA;
+static Jobs jobsB;
+static Jobs jobsC;
+
+static void comeca(Jobs *j) {
+	if (j->n < Q_DIM(j->inicio)) {
+		j->inicio[j->n] = rtos::OS_getTime();
+	}
+	j->n++;
+}
+
+static void tarefaA() {
+	comeca(&jobsA);
+}
+
+static void tarefaB() {
+	comeca(&jobsB);
+}
+
+static void tarefaC() {
+	comeca(&jobsC);
+	if (jobsC.n == 2U) {
+		rtos::OS_delay(6U); /* termina em 33 > 27 + 5, antes da liberacao de 47 */
+	}
+}
+
+int main(void) {
+	rtos::OS_init(stack_idle, sizeof(stack_idle));
+	CHECK(rtos::OSPeriodicTask_start(&a, &tarefaA, stack_a, sizeof(stack_a), 10U));
+	CHECK(rtos::OSPeriodicTask_start(&b, &tarefaB, stack_b, sizeof(stack_b), 10U, 0U, 3U));
+	CHECK(rtos::OSPeriodicTask_start(&c, &tarefaC, stack_c, sizeof(stack_c), 20U, 0U, 7U, 5U));
+	rtos::OSPeriodicTask_setMissPolicy(&c, rtos::OS_MISS_SKIP);
+	rtos::OS_portStopAt(49U); /* fora de uma liberacao */
+	rtos::OS_run();
+
+	CHECK(jobsA.n == 5U && jobsB.n == 5U);
+	for (uint32_t k = 0U; k < 5U; k++) {
+		CHECK(jobsA.inicio[k] == 10U * k);
+		CHECK(jobsB.inicio[k] == 10U * k + 3U);
+	}
+	/* a perda do job de 27 descarta o de 47 */
+	CHECK(jobsC.n == 2U);
+	CHECK(jobsC.inicio[0] == 7U && jobsC.inicio[1] == 27U);
+	CHECK(c.misses == 1U && c.skipped == 1U);
+	CHECK(a.misses == 0U && b.misses == 0U);
+
+	/* liberacoes e deadlines defasados: ultimas em 40, 43 e 47 */
+	CHECK(a.nextRelease == 50U && a.deadline == 50U);
+	CHECK(b.nextRelease == 53U && b.deadline == 53U);
+	CHECK(c.nextRelease == 67U);
+#if MIROS_CFG_RELEASE_TABLE
+	return testeFim("test_offset (tabela)");
+#else
+	return testeFim("test_offset (fila)");
+#endif
+}
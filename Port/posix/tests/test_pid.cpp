@@ -0,0 +1,85 @@
+/*
+ * test_pid.cpp
+ *
+ * PidF e PidQ31 com a mesma configuracao e a mesma sequencia de erros
+ * tem que dar a mesma saida, a menos da quantizacao do Q31. Duas
+ * configuracoes: a do controle.cpp, que nunca satura, e uma com ganhos
+ * altos, em que a saida passa longos trechos no limite e o anti-windup
+ * dos dois tem que soltar no mesmo passo. Uma troca de ganhos no meio
+ * mantem o integrador nos dois.
+ */
+
+#include <cmath>
+#include <cstdint>
+#include "pid.h"
+#include "qassert.h"
+#include "teste.h"
+
+#define PASSOS 2000U
+#define IN_SCALE 1024.0f /* mm */
+#define OUT_SCALE 64.0f /* % de duty */
+
+static float saidaQ31(int32_t u) {
+	return (float)u / 2147483648.0f * OUT_SCALE;
+}
+
+/* senoide lenta com ruido: atravessa zero e, com ganho alto, satura */
+static uint32_t seed;
+static float erroNoPasso(uint32_t k) {
+	seed = seed * 1664525U + 1013904223U;
+	return 400.0f * std::sin((float)k * 0.02f) + (float)((seed >> 24) % 21U) - 10.0f;
+}
+
+/* maior diferenca entre as saidas; conta passos no limite e em que so um satura */
+static float compara(PidConfig *cfg, PidConfig const *retune, uint32_t *saturados,
+		uint32_t *divergentes) {
+	PidF pf;
+	PidQ31 pq;
+	float pior = 0.0f;
+	pidInitF(&pf, cfg);
+	pidInitQ31(&pq, cfg, IN_SCALE, OUT_SCALE);
+	seed = 1U;
+	*saturados = 0U;
+	*divergentes = 0U;
+	for (uint32_t k = 0U; k < PASSOS; k++) {
+		if (k == PASSOS / 2U && retune != (PidConfig const *)0) {
+			pidTuneF(&pf, retune);
+			pidTuneQ31(&pq, retune, IN_SCALE, OUT_SCALE);
+		}
+		float e = erroNoPasso(k);
+		float uf = pidUpdateF(&pf, e);
+		int32_t uq = pidUpdateQ31(&pq, pidToQ31(e, IN_SCALE));
+		float d = std::fabs(uf - saidaQ31(uq));
+		pior = (d > pior) ? d : pior;
+		bool limiteF = (uf == pf.outMax || uf == pf.outMin);
+		bool limiteQ = (uq == pq.outMax || uq == pq.outMin);
+		*saturados += limiteF ? 1U : 0U;
+		*divergentes += (limiteF != limiteQ) ? 1U : 0U;
+	}
+	return pior;
+}
+
+int main(void) {
+	uint32_t saturados;
+	uint32_t divergentes;
+
+	/* controle.cpp: ganhos baixos, sem saturar */
+	PidConfig controle = { -0.01f, -0.001f, -0.001f, 0.050f, -30.0f, 30.0f };
+	float pior = compara(&controle, (PidConfig const *)0, &saturados, &divergentes);
+	CHECK(saturados == 0U);
+	CHECK(pior < 1e-4f); /* % de duty */
+
+	/* ganhos altos, com troca no meio: satura e sai da saturacao */
+	PidConfig alto = { 0.1f, 0.5f, 0.01f, 0.050f, -30.0f, 30.0f };
+	PidConfig outro = { 0.05f, 0.2f, 0.02f, 0.050f, -20.0f, 25.0f };
+	pior = compara(&alto, &outro, &saturados, &divergentes);
+	CHECK(saturados > PASSOS / 10U);
+	CHECK(divergentes == 0U);
+	CHECK(pior < 1e-4f);
+
+	/* conversao para Q31 satura em vez de dar a volta */
+	CHECK(pidToQ31(2048.0f, IN_SCALE) == INT32_MAX);
+	CHECK(pidToQ31(-2048.0f, IN_SCALE) == INT32_MIN);
+	CHECK(pidToQ31(512.0f, IN_SCALE) == (int32_t)0x40000000);
+	return testeFim("test_pid");
+}
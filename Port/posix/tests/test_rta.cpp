@@ -0,0 +1,45 @@
+/*
+ * test_rta.cpp
+ *
+ * Admissao RM com periodos longos: 500000 ticks sao 5e9 us, acima de
+ * 32 bits. T1 = (10 ticks, 80 ms) e T2 = (500000 ticks, 5e8 us) somam
+ * U = 0.9, fora do limite de Liu & Layland, entao passam pela RTA:
+ * R2 = 5e8 / (1 - 0.8) = 2.5e9 us cabe no deadline de 5e9 us. Cada passo
+ * so fecha 20% do que falta, entao R2 leva 42 iteracoes para
+ * convergir. Uma tarefa sem WCET depois das admitidas e recusada.
+ */
+
+#include <cstdint>
+#include "miros.h"
+#include "miros_port.h"
+#include "qassert.h"
+#include "teste.h"
+
+static uint8_t stack_idle[64 * 1024];
+static uint8_t stack_t1[64 * 1024];
+static uint8_t stack_t2[64 * 1024];
+static uint8_t stack_t3[64 * 1024];
+static uint8_t stack_t4[64 * 1024];
+static rtos::OSPeriodicTask t1;
+static rtos::OSPeriodicTask t2;
+static rtos::OSPeriodicTask t3;
+static rtos::OSPeriodicTask t4;
+
+static void vazia() {
+}
+
+int main(void) {
+	rtos::OS_init(stack_idle, sizeof(stack_idle));
+	CHECK(rtos::OSPeriodicTask_start(&t1, &vazia, stack_t1, sizeof(stack_t1),
+			10U, 80000U));
+	CHECK(rtos::OSPeriodicTask_start(&t2, &vazia, stack_t2, sizeof(stack_t2),
+			500000U, 500000000U));
+	/* U = 0.95, mas com D3 = 3e9 us (acima de T2 na prioridade)
+	* R3 = 1e9 / (1 - 0.8) = 5e9 us nao cabe
+	*/
+	CHECK(!rtos::OSPeriodicTask_start(&t3, &vazia, stack_t3, sizeof(stack_t3),
+			2000000U, 1000000000U, 0U, 300000U));
+	/* sem WCET ela tiraria CPU de T1 e T2 sem aparecer na analise */
+	CHECK(!rtos::OSPeriodicTask_start(&t4, &vazia, stack_t4, sizeof(stack_t4), 20U));
+	return testeFim("test_rta");
+}
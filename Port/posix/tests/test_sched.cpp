@@ -0,0 +1,87 @@
+/*
+ * test_sched.cpp
+ *
+ * Escalonamento de duas tarefas periodicas, compilado uma vez com RM e
+ * outra com EDF. T1 = (T 10, C 4.25) e T2 = (T 16, C 6) ticks, U = 0.8:
+ * no tick 10 o segundo job de T1 (deadline 20) chega com o primeiro de
+ * T2 (deadline 16) ainda rodando. No RM T1 preempta; no EDF T2 termina
+ * antes. Os fins de job sao medidos em ciclos simulados, sem custo de
+ * kernel, entao os tempos sao exatos.
+ */
+
+#include <cstdint>
+#include "miros.h"
+#include "miros_port.h"
+#include "qassert.h"
+#include "teste.h"
+
+#define TICK (SystemCoreClock / rtos::TICKS_PER_SEC) /* ciclos */
+
+static uint8_t stack_idle[64 * 1024];
+static uint8_t stack_t1[64 * 1024];
+static uint8_t stack_t2[64 * 1024];
+static rtos::OSPeriodicTask t1;
+static rtos::OSPeriodicTask t2;
+
+static uint64_t fim1[128];
+static uint64_t fim2[128];
+static uint32_t n1;
+static uint32_t n2;
+
+static void tarefa1() {
+	rtos::OS_portBurn(TICK * 17U / 4U);
+	if (n1 < Q_DIM(fim1)) {
+		fim1[n1] = rtos::OS_portCycles;
+	}
+	n1++;
+}
+
+static void tarefa2() {
+	rtos::OS_portBurn(TICK * 6U);
+	if (n2 < Q_DIM(fim2)) {
+		fim2[n2] = rtos::OS_portCycles;
+	}
+	n2++;
+}
+
+int main(void) {
+	rtos::OS_init(stack_idle, sizeof(stack_idle));
+	/* os WCETs passam pela admissao (RTA no RM, densidade no EDF) */
+	CHECK(rtos::OSPeriodicTask_start(&t1, &tarefa1, stack_t1, sizeof(stack_t1),
+			10U, 42500U));
+	CHECK(rtos::OSPeriodicTask_start(&t2, &tarefa2, stack_t2, sizeof(stack_t2),
+			16U, 60000U));
+	rtos::OS_portStopAt(800U); /* 10 hiperperiodos */
+	rtos::OS_run();
+
+	CHECK(fim1[0] == TICK * 17U / 4U);
+#if MIROS_CFG_SCHED_POLICY == MIROS_SCHED_EDF
+	CHECK(fim2[0] == TICK * 41U / 4U); /* 10.25: segue ate o fim */
+	CHECK(fim1[1] == TICK * 29U / 2U); /* 14.5: esperou T2 */
+#else
+	CHECK(fim1[1] == TICK * 57U / 4U); /* 14.25: preemptou T2 no tick 10 */
+	CHECK(fim2[0] == TICK * 29U / 2U); /* 14.5 */
+#endif
+
+	/* todos os jobs liberados antes do fim e nenhuma perda */
+	CHECK(n1 == 80U);
+	CHECK(n2 == 50U);
+	CHECK(t1.misses == 0U && t2.misses == 0U);
+#if MIROS_CFG_STACK_CHECK
+	/* a marca d'agua ve o que as fibras usaram, e so isso */
+	CHECK(rtos::OS_stackUsed(t1.myThreadIndex) != 0U
+		  && rtos::OS_stackUsed(t1.myThreadIndex) < sizeof(stack_t1));
+	CHECK(rtos::OS_stackUsed(0U) != 0U && rtos::OS_stackUsed(0U) < sizeof(stack_idle));
+#endif
+	for (uint32_t k = 0U; k < n1 && k < Q_DIM(fim1); k++) {
+		CHECK(fim1[k] <= (uint64_t)(10U * k + 10U) * TICK);
+	}
+	for (uint32_t k = 0U; k < n2 && k < Q_DIM(fim2); k++) {
+		CHECK(fim2[k] <= (uint64_t)(16U * k + 16U) * TICK);
+	}
+#if MIROS_CFG_SCHED_POLICY == MIROS_SCHED_EDF
+	return testeFim("test_sched (EDF)");
+#else
+	return testeFim("test_sched (RM)");
+#endif
+}
@@ -0,0 +1,160 @@
+/*
+ * test_sem.cpp
+ *
+ * Listas de espera do OSSem e do OSEventFlags. Duas tarefas bloqueiam no
+ * semaforo, a menos prioritaria no tick 0 e a outra no tick 1, e uma ISR
+ * da um give nos ticks 5 e 7: acorda primeiro a mais prioritaria, mesmo
+ * tendo bloqueado depois. Nas flags,
+ * uma espera ALL|CLEAR por 0x3 e uma ANY por 0x2: o set de 0x1 no tick
+ * 10 nao acorda ninguem e o de 0x2 no tick 12 acorda as duas, com as
+ * flags consumidas so no fim. Uma espera em cada objeto expira no
+ * timeout, no tick certo.
+ */
+
+#include <cstdint>
+#include "miros.h"
+#include "miros_port.h"
+#include "qassert.h"
+#include "teste.h"
+
+static uint8_t stack_idle[64 * 1024];
+static uint8_t stacks[6][64 * 1024];
+static rtos::OSPeriodicTask semAlta;
+static rtos::OSPeriodicTask semBaixa;
+static rtos::OSPeriodicTask semTimeout;
+static rtos::OSPeriodicTask flagsAlta;
+static rtos::OSPeriodicTask flagsBaixa;
+static rtos::OSPeriodicTask flagsTimeout;
+static rtos::OSSem sem;
+static rtos::OSSem semVazio;
+static rtos::OSEventFlags flags;
+
+typedef struct {
+	uint64_t acordou; /* tick em que a espera terminou */
+	uint32_t ordem; /* 1 = a primeira a acordar */
+	uint32_t resultado; /* true/false do take ou flags recebidas */
+} Espera;
+
+static Espera eSemAlta;
+static Espera eSemBaixa;
+static Espera eSemTimeout;
+static Espera eFlagsAlta;
+static Espera eFlagsBaixa;
+static Espera eFlagsTimeout;
+static uint32_t acordadas;
+
+static void registra(Espera *e, uint32_t resultado) {
+	e->acordou = rtos::OS_getTime();
+	e->ordem = ++acordadas;
+	e->resultado = resultado;
+}
+
+/* a baixa bloqueia no tick 0; a alta, com offset, so no tick 1 */
+static void tarefaSemBaixa() {
+	registra(&eSemBaixa, rtos::OSSem_take(&sem, rtos::OS_WAIT_FOREVER));
+}
+
+static void tarefaSemAlta() {
+	registra(&eSemAlta, rtos::OSSem_take(&sem, rtos::OS_WAIT_FOREVER));
+}
+
+static void tarefaSemTimeout() {
+	registra(&eSemTimeout, rtos::OSSem_take(&semVazio, 3U));
+}
+
+static void tarefaFlagsAlta() {
+	registra(&eFlagsAlta, rtos::OSEventFlags_wait(&flags, 0x3U,
+			rtos::OS_FLAGS_ALL | rtos::OS_FLAGS_CLEAR, rtos::OS_WAIT_FOREVER));
+}
+
+static void tarefaFlagsBaixa() {
+	registra(&eFlagsBaixa, rtos::OSEventFlags_wait(&flags, 0x2U, rtos::OS_FLAGS_ANY,
+			rtos::OS_WAIT_FOREVER));
+}
+
+static void tarefaFlagsTimeout() {
+	registra(&eFlagsTimeout, rtos::OSEventFlags_wait(&flags, 0x8U, rtos::OS_FLAGS_ANY, 4U));
+}
+
+static void isrGive(void) {
+	CHECK(rtos::OSSem_give(&sem));
+}
+
+static void isrSet1(void) {
+	rtos::OSEventFlags_set(&flags, 0x1U);
+}
+
+static void isrSet2(void) {
+	rtos::OSEventFlags_set(&flags, 0x2U);
+}
+
+/* interrupcoes injetadas pela idle, uma vez em cada instante */
+static void injeta(void) {
+	static uint64_t ultimo = 0U;
+	uint64_t agora = rtos::OS_getTime();
+	if (agora == ultimo) {
+		return;
+	}
+	ultimo = agora;
+	if (agora == 5U || agora == 7U) {
+		rtos::OS_portIrq(1U, &isrGive);
+	}
+	else if (agora == 10U) {
+		rtos::OS_portIrq(2U, &isrSet1);
+	}
+	else if (agora == 12U) {
+		rtos::OS_portIrq(2U, &isrSet2);
+	}
+}
+
+int main(void) {
+	rtos::OS_init(stack_idle, sizeof(stack_idle));
+	rtos::OSSem_init(&sem, 0U, 1U);
+	rtos::OSSem_init(&semVazio, 0U, 1U);
+	rtos::OSEventFlags_init(&flags);
+
+	/* sem ninguem esperando o give conta ate max, e o take sem espera
+	* consome ou falha na hora
+	*/
+	CHECK(rtos::OSSem_give(&sem) && !rtos::OSSem_give(&sem));
+	CHECK(rtos::OSSem_take(&sem, 0U) && !rtos::OSSem_take(&sem, 0U));
+	rtos::OSEventFlags_set(&flags, 0x4U);
+	CHECK(rtos::OSEventFlags_wait(&flags, 0x6U, rtos::OS_FLAGS_ALL, 0U) == 0U);
+	CHECK(rtos::OSEventFlags_wait(&flags, 0x6U, rtos::OS_FLAGS_ANY | rtos::OS_FLAGS_CLEAR, 0U)
+			== 0x4U);
+	CHECK(flags.flags == 0U);
+
+	/* periodos longos: um job de cada; a ordem de prioridade segue o periodo */
+	CHECK(rtos::OSPeriodicTask_start(&semBaixa, &tarefaSemBaixa, stacks[0], sizeof(stacks[0]),
+			160U));
+	CHECK(rtos::OSPeriodicTask_start(&semAlta, &tarefaSemAlta, stacks[1], sizeof(stacks[1]),
+			100U, 0U, 1U));
+	CHECK(rtos::OSPeriodicTask_start(&semTimeout, &tarefaSemTimeout, stacks[2], sizeof(stacks[2]),
+			110U));
+	CHECK(rtos::OSPeriodicTask_start(&flagsAlta, &tarefaFlagsAlta, stacks[3], sizeof(stacks[3]),
+			120U));
+	CHECK(rtos::OSPeriodicTask_start(&flagsBaixa, &tarefaFlagsBaixa, stacks[4], sizeof(stacks[4]),
+			130U));
+	CHECK(rtos::OSPeriodicTask_start(&flagsTimeout, &tarefaFlagsTimeout, stacks[5],
+			sizeof(stacks[5]), 140U));
+	rtos::OS_portSetIdleHook(&injeta);
+	rtos::OS_portStopAt(30U);
+	rtos::OS_run();
+
+	/* timeouts */
+	CHECK(eSemTimeout.resultado == 0U && eSemTimeout.acordou == 3U);
+	CHECK(eFlagsTimeout.resultado == 0U && eFlagsTimeout.acordou == 4U);
+
+	/* semaforo: a mais prioritaria primeiro */
+	CHECK(eSemAlta.resultado == 1U && eSemAlta.acordou == 5U);
+	CHECK(eSemBaixa.resultado == 1U && eSemBaixa.acordou == 7U);
+	CHECK(eSemAlta.ordem < eSemBaixa.ordem);
+	CHECK(sem.count == 0U && sem.waiters.empty());
+
+	/* flags: as duas esperas no tick 12, e o CLEAR nao tira a 0x2 da ANY */
+	CHECK(eFlagsAlta.resultado == 0x3U && eFlagsAlta.acordou == 12U);
+	CHECK(eFlagsBaixa.resultado == 0x2U && eFlagsBaixa.acordou == 12U);
+	CHECK(eFlagsAlta.ordem < eFlagsBaixa.ordem); /* o escalonador decide quem roda antes */
+	CHECK(flags.flags == 0U && flags.waiters.empty());
+	return testeFim("test_sem");
+}
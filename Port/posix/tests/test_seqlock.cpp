@@ -0,0 +1,117 @@
+/*
+ * test_seqlock.cpp
+ *
+ * OSSeqLock com preempcao no meio das copias: o dado de teste gasta 0.3
+ * tick entre os dois campos, entao ticks e preempcoes caem dentro de
+ * read() e write(). Dois seqlocks:
+ *  - A: escritor lento (T 10) preemptado por um leitor a cada tick. O
+ *    leitor nunca espera nem repete, e ve o valor antigo ou o novo, nunca
+ *    metade de cada.
+ *  - B: leitor lento (T 20) preemptado pelo escritor (T 5). O leitor
+ *    repete as leituras atravessadas por uma escrita e tambem so ve
+ *    valores inteiros.
+ */
+
+#include <cstdint>
+#include "miros.h"
+#include "miros_port.h"
+#include "seqlock.h"
+#include "qassert.h"
+#include "teste.h"
+
+#define TICK (SystemCoreClock / rtos::TICKS_PER_SEC) /* ciclos */
+
+/* copia em duas metades, com tempo de CPU entre elas */
+struct Lento {
+	uint32_t a;
+	uint32_t b;
+	Lento() : a(0U), b(0U) {}
+	explicit Lento(uint32_t v) : a(v), b(v) {}
+	Lento(Lento const &o) = default;
+	Lento &operator=(Lento const &o);
+};
+
+static uint32_t copias[8]; /* por indice de thread */
+
+Lento &Lento::operator=(Lento const &o) {
+	copias[rtos::OS_curr->index]++;
+	a = o.a;
+	rtos::OS_portBurn(TICK * 3U / 10U);
+	b = o.b;
+	return *this;
+}
+
+static uint8_t stack_idle[64 * 1024];
+static uint8_t stacks[4][64 * 1024];
+static rtos::OSPeriodicTask leitorRapido;
+static rtos::OSPeriodicTask escritorRapido;
+static rtos::OSPeriodicTask escritorLento;
+static rtos::OSPeriodicTask leitorLento;
+static rtos::OSSeqLock<Lento> seqA;
+static rtos::OSSeqLock<Lento> seqB;
+
+static uint32_t escritasA;
+static uint32_t escritasB;
+static uint32_t leiturasRapido;
+static uint32_t leiturasLento;
+static uint32_t ultimoRapido;
+static uint32_t ultimoLento;
+static bool rasgado; /* alguma leitura misturou duas escritas */
+static bool voltou; /* alguma leitura viu um valor mais antigo que o anterior */
+
+static void confere(Lento const &v, uint32_t *ultimo) {
+	rasgado = rasgado || v.a != v.b;
+	voltou = voltou || v.a < *ultimo;
+	*ultimo = v.a;
+}
+
+static void tarefaLeitorRapido() {
+	confere(seqA.read(), &ultimoRapido);
+	leiturasRapido++;
+}
+
+static void tarefaEscritorLento() {
+	escritasA++;
+	seqA.write(Lento(escritasA));
+}
+
+static void tarefaEscritorRapido() {
+	escritasB++;
+	seqB.write(Lento(escritasB));
+}
+
+static void tarefaLeitorLento() {
+	for (uint32_t i = 0U; i < 10U; i++) {
+		confere(seqB.read(), &ultimoLento);
+		leiturasLento++;
+	}
+}
+
+int main(void) {
+	rtos::OS_init(stack_idle, sizeof(stack_idle));
+	CHECK(rtos::OSPeriodicTask_start(&leitorRapido, &tarefaLeitorRapido, stacks[0],
+			sizeof(stacks[0]), 1U));
+	CHECK(rtos::OSPeriodicTask_start(&escritorRapido, &tarefaEscritorRapido, stacks[1],
+			sizeof(stacks[1]), 5U));
+	CHECK(rtos::OSPeriodicTask_start(&escritorLento, &tarefaEscritorLento, stacks[2],
+			sizeof(stacks[2]), 10U));
+	CHECK(rtos::OSPeriodicTask_start(&leitorLento, &tarefaLeitorLento, stacks[3],
+			sizeof(stacks[3]), 20U));
+	rtos::OS_portStopAt(200U);
+	rtos::OS_run();
+
+	CHECK(!rasgado && !voltou);
+	CHECK(escritasA == 20U && escritasB == 40U);
+	CHECK(ultimoRapido == escritasA && ultimoLento != 0U); /* o leitor de A le ate o fim */
+
+	/* o leitor de A e mais prioritario que o escritor: uma copia por leitura */
+	CHECK(leiturasRapido == 200U);
+	CHECK(copias[leitorRapido.myThreadIndex] == leiturasRapido);
+	/* o de B foi atravessado por escritas e repetiu algumas leituras */
+	CHECK(leiturasLento == 100U);
+	CHECK(copias[leitorLento.myThreadIndex] > leiturasLento);
+
+	CHECK(leitorRapido.misses == 0U && escritorRapido.misses == 0U);
+	CHECK(escritorLento.misses == 0U && leitorLento.misses == 0U);
+	return testeFim("test_seqlock");
+}
@@ -0,0 +1,65 @@
+/*
+ * test_server.cpp
+ *
+ * Servidor esporadico (Ts 10, Cs 3 ticks) com um job de 5.5 ticks: o
+ * budget acaba no tick 3 com o job no meio, e nenhum outro job chega ate
+ * a reposicao no tick 10. O job tem que continuar dali e terminar em
+ * 12.5. Um segundo job postado no tick 20 confere que o servidor segue
+ * atendendo depois.
+ */
+
+#include <cstdint>
+#include "miros.h"
+#include "miros_port.h"
+#include "qassert.h"
+#include "teste.h"
+
+#define TICK (SystemCoreClock / rtos::TICKS_PER_SEC) /* ciclos */
+
+static uint8_t stack_idle[64 * 1024];
+static uint8_t stack_server[64 * 1024];
+static rtos::OSSporadicServer server;
+static rtos::OSAperiodicTask jobLongo;
+static rtos::OSAperiodicTask jobCurto;
+static uint64_t fimLongo;
+static uint64_t fimCurto;
+
+static void longo() {
+	rtos::OS_portBurn(TICK * 11U / 2U);
+	fimLongo = rtos::OS_portCycles;
+}
+
+static void curto() {
+	rtos::OS_portBurn(TICK / 4U);
+	fimCurto = rtos::OS_portCycles;
+}
+
+/* os jobs chegam pela idle, como viriam de uma ISR */
+static void posta(void) {
+	static bool longoPostado = false;
+	static bool curtoPostado = false;
+	if (!longoPostado) {
+		longoPostado = true;
+		CHECK(rtos::OSAperiodicTask_start(&jobLongo, &longo));
+	}
+	if (!curtoPostado && rtos::OS_getTime() >= 20U) {
+		curtoPostado = true;
+		CHECK(rtos::OSAperiodicTask_start(&jobCurto, &curto));
+	}
+}
+
+int main(void) {
+	rtos::OS_init(stack_idle, sizeof(stack_idle));
+	CHECK(rtos::OSSporadicServer_start(&server, stack_server, sizeof(stack_server),
+			10U, 3U));
+	rtos::AperiodicServerStart();
+	rtos::OS_portSetIdleHook(&posta);
+	rtos::OS_portStopAt(40U);
+	rtos::OS_run();
+
+	/* 3 ticks ate o budget acabar, 2.5 depois da reposicao no tick 10 */
+	CHECK(fimLongo == TICK * 25U / 2U);
+	CHECK(fimCurto == TICK * 81U / 4U);
+	CHECK(!server.active);
+	return testeFim("test_server");
+}
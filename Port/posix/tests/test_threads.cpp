@@ -0,0 +1,65 @@
+/*
+ * test_threads.cpp
+ *
+ * Mais de 32 threads: compilado com MIROS_CFG_MAX_THREADS=64, com RM e
+ * com EDF. 40 tarefas periodicas, a k-esima (thread k + 1) com periodo
+ * 100 - k ticks, entao a ultima criada e a mais prioritaria e os slots
+ * passam da primeira palavra do conjunto de prontas. No tick 0 todas sao
+ * liberadas juntas e tem que executar da mais para a menos prioritaria;
+ * depois cada uma executa um job por periodo, sem perdas.
+ */
+
+#include <cstdint>
+#include "miros.h"
+#include "miros_port.h"
+#include "qassert.h"
+#include "teste.h"
+
+#define TICK (SystemCoreClock / rtos::TICKS_PER_SEC) /* ciclos */
+#define NUM_TAREFAS 40U
+#define FIM 200U /* ticks simulados */
+
+static uint8_t stack_idle[64 * 1024];
+static uint8_t stacks[NUM_TAREFAS][64 * 1024];
+static rtos::OSPeriodicTask tarefas[NUM_TAREFAS];
+
+static uint16_t ordem[NUM_TAREFAS]; /* threads na ordem dos primeiros jobs */
+static uint32_t numOrdem;
+static uint32_t jobs[NUM_TAREFAS + 1U]; /* por indice de thread */
+
+/* a mesma funcao para todas: a thread atual diz quem e */
+static void tarefa() {
+	uint16_t idx = rtos::OS_curr->index;
+	if (numOrdem < NUM_TAREFAS) {
+		ordem[numOrdem++] = idx;
+	}
+	jobs[idx]++;
+	rtos::OS_portBurn(TICK / 100U);
+}
+
+int main(void) {
+	rtos::OS_init(stack_idle, sizeof(stack_idle));
+	for (uint32_t k = 0U; k < NUM_TAREFAS; k++) {
+		CHECK(rtos::OSPeriodicTask_start(&tarefas[k], &tarefa, stacks[k], sizeof(stacks[k]),
+				100U - k));
+	}
+	CHECK(rtos::OS_threadNum == NUM_TAREFAS + 1U);
+	rtos::OS_portStopAt(FIM);
+	rtos::OS_run();
+
+	CHECK(numOrdem == NUM_TAREFAS);
+	for (uint32_t j = 0U; j < NUM_TAREFAS; j++) {
+		CHECK(ordem[j] == NUM_TAREFAS - j);
+	}
+	for (uint32_t k = 0U; k < NUM_TAREFAS; k++) {
+		uint32_t periodo = 100U - k;
+		CHECK(tarefas[k].myThreadIndex == k + 1U);
+		CHECK(jobs[k + 1U] == (FIM + periodo - 1U) / periodo);
+		CHECK(tarefas[k].misses == 0U);
+	}
+#if MIROS_CFG_SCHED_POLICY == MIROS_SCHED_EDF
+	return testeFim("test_threads (EDF)");
+#else
+	return testeFim("test_threads (RM)");
+#endif
+}
@@ -0,0 +1,109 @@
+/*
+ * test_timer.cpp
+ *
+ * Fila de timeouts (lista delta): ordem de expiracao, empate na ordem de
+ * insercao, disarm no meio da lista, rearme de dentro do handler e o
+ * OS_delay de uma thread em cima do tick simulado.
+ */
+
+#include <cstdint>
+#include "miros.h"
+#include "miros_port.h"
+#include "qassert.h"
+#include "teste.h"
+
+static uint32_t agora; /* tick da fila local */
+static char ordem[16];
+static uint32_t quando[16];
+static uint8_t disparos;
+
+static void marca(void *arg) {
+	if (disparos < sizeof(ordem)) {
+		ordem[disparos] = *(char const *)arg;
+		quando[disparos] = agora;
+		disparos++;
+	}
+}
+
+static rtos::OSTimerQueue fila;
+static rtos::OSTimer periodico;
+
+static void rearma(void *arg) {
+	marca(arg);
+	if (agora < 8U) {
+		rtos::OSTimerQueue_arm(&fila, &periodico, 2U);
+	}
+}
+
+static void testeFila(void) {
+	static char const a = 'a', b = 'b', c = 'c', d = 'd', e = 'e', p = 'p';
+	rtos::OSTimer ta, tb, tc, td, te;
+	rtos::OSTimer_init(&ta, &marca, (void *)&a);
+	rtos::OSTimer_init(&tb, &marca, (void *)&b);
+	rtos::OSTimer_init(&tc, &marca, (void *)&c);
+	rtos::OSTimer_init(&td, &marca, (void *)&d);
+	rtos::OSTimer_init(&te, &marca, (void *)&e);
+	rtos::OSTimer_init(&periodico, &rearma, (void *)&p);
+
+	rtos::OSTimerQueue_arm(&fila, &ta, 5U);
+	rtos::OSTimerQueue_arm(&fila, &tb, 3U);
+	rtos::OSTimerQueue_arm(&fila, &tc, 5U); /* mesmo tick: depois de a */
+	rtos::OSTimerQueue_arm(&fila, &td, 9U);
+	rtos::OSTimerQueue_arm(&fila, &te, 4U);
+	rtos::OSTimerQueue_arm(&fila, &periodico, 2U);
+	CHECK(fila.head == &periodico && fila.head->delta == 2U);
+
+	/* tirar e do meio nao pode atrasar nem adiantar os seguintes */
+	rtos::OSTimerQueue_disarm(&fila, &te);
+	CHECK(!te.armed);
+	rtos::OSTimerQueue_disarm(&fila, &te); /* desarmado: nada muda */
+
+	for (agora = 1U; agora <= 10U; agora++) {
+		rtos::OSTimerQueue_tick(&fila);
+	}
+
+	static char const ordemEsperada[] = { 'p', 'b', 'p', 'a', 'c', 'p', 'p', 'd' };
+	static uint32_t const quandoEsperado[] = { 2U, 3U, 4U, 5U, 5U, 6U, 8U, 9U };
+	CHECK(disparos == sizeof(ordemEsperada));
+	for (uint8_t k = 0U; k < disparos && k < sizeof(ordemEsperada); k++) {
+		CHECK(ordem[k] == ordemEsperada[k]);
+		CHECK(quando[k] == quandoEsperado[k]);
+	}
+	CHECK(fila.head == (rtos::OSTimer *)0);
+	CHECK(!ta.armed && !td.armed && !periodico.armed);
+}
+
+/* OS_delay dentro de um job: a thread acorda exatamente no tick pedido */
+static uint8_t stack_idle[64 * 1024];
+static uint8_t stack_dorme[64 * 1024];
+static rtos::OSPeriodicTask dorme;
+static uint64_t acordou[4];
+static uint8_t nAcordou;
+
+static void dormeJob() {
+	for (uint8_t k = 0U; k < 2U && nAcordou < Q_DIM(acordou); k++) {
+		rtos::OS_delay(7U);
+		acordou[nAcordou++] = rtos::OS_getTime();
+		rtos::OS_portBurn(SystemCoreClock / rtos::TICKS_PER_SEC / 2U); /* meio tick */
+	}
+}
+
+static void testeDelay(void) {
+	rtos::OS_init(stack_idle, sizeof(stack_idle));
+	rtos::OSPeriodicTask_start(&dorme, &dormeJob, stack_dorme, sizeof(stack_dorme), 50U);
+	rtos::OS_portStopAt(100U);
+	rtos::OS_run();
+
+	/* o meio tick de trabalho nao acumula: a espera conta ticks inteiros */
+	CHECK(nAcordou == 4U);
+	CHECK(acordou[0] == 7U);
+	CHECK(acordou[1] == 14U);
+	CHECK(acordou[2] == 57U);
+	CHECK(acordou[3] == 64U);
+}
+
+int main(void) {
+	testeFila();
+	testeDelay();
+	return testeFim("test_timer");
+}
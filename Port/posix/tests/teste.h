@@ -0,0 +1,28 @@
+/*
+ * teste.h
+ *
+ * Verificacao minima dos testes do kernel no porte POSIX: cada teste e
+ * um executavel (o estado do kernel e global) e sai com 1 se algum
+ * CHECK falhou.
+ */
+
+#ifndef TESTE_H_
+#define TESTE_H_
+
+#include <cstdio>
+
+static int testeFalhas = 0;
+
+#define CHECK(cond_) do { \
+	if (!(cond_)) { \
+		fprintf(stderr, "%s:%d: falhou: %s\n", __FILE__, __LINE__, #cond_); \
+		testeFalhas++; \
+	} \
+} while (0)
+
+static inline int testeFim(char const *nome) {
+	printf("%s: %s\n", nome, (testeFalhas == 0) ? "ok" : "FALHOU");
+	return (testeFalhas == 0) ? 0 : 1;
+}
+
+#endif /* TESTE_H_ */
@@ -0,0 +1,112 @@
+#!/usr/bin/env python3
+"""Roda a suite de benchmarks do MiROS no Renode e grava os ciclos em JSON.
+
+A firmware e a configuracao Bench (MIROS_BENCH + MIROS_BENCH_SUITE).
+O str-renode-bench.resc grava OS_benchResults[] quando a firmware chega
+em OS_benchDone(); este script espera o arquivo, encerra o Renode e
+imprime a tabela.
+
+    python3 bench_renode.py
+    python3 bench_renode.py --elf Bench/str-miros-stm32-renode.elf -o atual.json
+    python3 bench_renode.py --baseline base.json --tolerance 5
+
+Com --baseline, sai com codigo 1 se alguma media piorou mais que a
+tolerancia (em %), para uso em CI.
+"""
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+import time
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+
+def run_renode(args):
+    out = os.path.abspath(args.output)
+    if os.path.exists(out):
+        os.remove(out)
+    env = dict(os.environ, MIROS_BENCH_OUT=out)
+    script = "$binpath=@%s; include @%s; start" % (
+        os.path.abspath(args.elf), os.path.join(HERE, "str-renode-bench.resc"))
+    cmd = [args.renode, "--console", "--disable-xwt", "-e", script]
+    proc = subprocess.Popen(cmd, env=env, stdin=subprocess.DEVNULL,
+                            stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    deadline = time.time() + args.timeout
+    data = None
+    try:
+        while time.time() < deadline and proc.poll() is None:
+            time.sleep(0.5)
+            try:
+                with open(out) as f:
+                    data = json.load(f)
+                break
+            except (OSError, ValueError):
+                continue  # ainda nao gravado, ou gravando
+    finally:
+        proc.kill()
+        proc.wait()
+    if data is None:
+        sys.exit("sem resultados em %s (a firmware chegou em OS_benchDone?)" % out)
+    return data
+
+
+def key(row):
+    return row["name"], row["param"]
+
+
+def print_table(data, base):
+    us = 1e6 / data["clock"]
+    print("%-16s %6s %6s %8s %8s %8s %9s" % (
+        "medicao", "param", "n", "min", "media", "max", "media us"))
+    for r in data["results"]:
+        line = "%-16s %6d %6d %8d %8d %8d %9.2f" % (
+            r["name"], r["param"], r["samples"], r["min"], r["avg"], r["max"],
+            r["avg"] * us)
+        if key(r) in base and base[key(r)]["avg"]:
+            line += "  %+6.1f%%" % (100.0 * (r["avg"] - base[key(r)]["avg"])
+                                    / base[key(r)]["avg"])
+        print(line)
+
+
+def regressions(data, base, tolerance):
+    worse = []
+    for r in data["results"]:
+        b = base.get(key(r))
+        if b and b["avg"] and r["avg"] > b["avg"] * (1.0 + tolerance / 100.0):
+            worse.append("%s(%d): %d -> %d ciclos" % (
+                r["name"], r["param"], b["avg"], r["avg"]))
+    return worse
+
+
+def main(argv=None):
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("--renode", default="renode", help="executavel do Renode")
+    ap.add_argument("--elf", default=os.path.join(
+        HERE, "Bench", "str-miros-stm32-renode.elf"),
+        help="firmware da configuracao Bench")
+    ap.add_argument("-o", "--output", default="bench_results.json",
+                    help="JSON de saida (padrao bench_results.json)")
+    ap.add_argument("--timeout", type=float, default=120.0,
+                    help="segundos de espera pelo resultado")
+    ap.add_argument("--baseline", help="JSON de uma rodada anterior")
+    ap.add_argument("--tolerance", type=float, default=10.0,
+                    help="piora aceita na media, em %% (padrao 10)")
+    args = ap.parse_args(argv)
+
+    data = run_renode(args)
+    base = {}
+    if args.baseline:
+        with open(args.baseline) as f:
+            base = {key(r): r for r in json.load(f)["results"]}
+    print_table(data, base)
+    worse = regressions(data, base, args.tolerance)
+    for w in worse:
+        print("regressao: " + w, file=sys.stderr)
+    return 1 if worse else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,316 @@
+#!/usr/bin/env python3
+"""Decodificador do trace binario do MiROS (Core/Inc/miros_trace.h).
+
+Le o fluxo bruto do SWO (pacotes ITM) capturado pelo probe, por exemplo:
+
+    openocd ... -c "stm32g4x.tpiu configure -protocol uart -output swo.bin \\
+        -traceclk 16000000 -pin-freq 2000000" -c "itm ports on"
+
+e gera a linha do tempo por tarefa e estatisticas de latencia.
+
+    python3 miros_trace.py swo.bin --names 1=LerSensor,2=CalculoPid,3=SetaVelocidade
+    python3 miros_trace.py swo.bin --timeline
+    python3 miros_trace.py swo.bin --chrome trace.json   # abre no Perfetto
+"""
+
+import argparse
+import json
+import sys
+from collections import defaultdict
+
+# portas de estimulo = tipos de evento (miros_trace.h)
+EV_SWITCH = 1
+EV_RELEASE = 2
+EV_DONE = 3
+EV_MISS = 4
+EV_ISR_ENTER = 5
+EV_ISR_EXIT = 6
+EV_SEM_TAKE = 7
+EV_SEM_BLOCK = 8
+EV_SEM_GIVE = 9
+EV_BUDGET = 10
+
+EV_NAMES = {
+    EV_SWITCH: "switch",
+    EV_RELEASE: "release",
+    EV_DONE: "done",
+    EV_MISS: "miss",
+    EV_ISR_ENTER: "isr_enter",
+    EV_ISR_EXIT: "isr_exit",
+    EV_SEM_TAKE: "sem_take",
+    EV_SEM_BLOCK: "sem_block",
+    EV_SEM_GIVE: "sem_give",
+    EV_BUDGET: "budget",
+}
+
+STAMP_MASK = 0xFFFFFF  # 24 bits de DWT->CYCCNT por evento
+
+# excecoes do Cortex-M com nome; as demais sao IRQn + 16
+EXC_NAMES = {11: "SVCall", 14: "PendSV", 15: "SysTick", 56: "EXTI15_10"}
+
+
+def itm_packets(data):
+    """Gera (porta, valor) das escritas nas portas de estimulo.
+
+    Pacotes de hardware (DWT), timestamps e extensoes sao pulados;
+    overflow do ITM vira porta None.
+    """
+    i = 0
+    n = len(data)
+    while i < n:
+        h = data[i]
+        i += 1
+        if h == 0x00 or h == 0x80:
+            continue  # sincronizacao (zeros terminados por 0x80)
+        if h == 0x70:
+            yield None, 0  # overflow: eventos perdidos no alvo
+            continue
+        size = h & 0x03
+        if size == 0:
+            # timestamp local/global ou extensao: continuacao pelo bit 7
+            if h & 0x80:
+                while i < n and data[i] & 0x80:
+                    i += 1
+                i += 1
+            continue
+        nbytes = 4 if size == 3 else size
+        if i + nbytes > n:
+            break
+        value = int.from_bytes(data[i:i + nbytes], "little")
+        i += nbytes
+        if h & 0x04:
+            continue  # pacote de hardware (DWT)
+        yield h >> 3, value
+
+
+def decode(data):
+    """Lista de (ciclos, tipo, arg) com o tempo desdobrado.
+
+    Cada evento carrega so 24 bits do contador; o SysTick gera eventos
+    a cada no maximo 2^24 ciclos, entao a diferenca modular para o
+    evento anterior e sempre o avanco real.
+    """
+    events = []
+    overflows = 0
+    now = None
+    last = 0
+    for port, value in itm_packets(data):
+        if port is None:
+            overflows += 1
+            continue
+        if port not in EV_NAMES:
+            continue  # porta 0 (texto) e outras
+        stamp = value & STAMP_MASK
+        if now is None:
+            now = stamp
+        else:
+            now += (stamp - last) & STAMP_MASK
+        last = stamp
+        events.append((now, port, value >> 24))
+    return events, overflows
+
+
+class Summary:
+    def __init__(self):
+        self.samples = []
+
+    def add(self, v):
+        self.samples.append(v)
+
+    def row(self, scale):
+        s = sorted(self.samples)
+        if not s:
+            return "-"
+        p99 = s[min(len(s) - 1, (len(s) * 99) // 100)]
+        return "n=%d min=%.1f avg=%.1f p99=%.1f max=%.1f" % (
+            len(s), s[0] * scale, sum(s) * scale / len(s),
+            p99 * scale, s[-1] * scale)
+
+
+def analyze(events):
+    """Linha do tempo por thread e estatisticas de latencia."""
+    segments = defaultdict(list)  # thread -> [(inicio, fim)]
+    isr_segments = defaultdict(list)  # excecao -> [(inicio, fim)]
+    response = defaultdict(Summary)  # liberacao -> fim do job
+    latency = defaultdict(Summary)  # liberacao -> primeira execucao
+    isr_time = defaultdict(Summary)
+    sem_block = defaultdict(Summary)  # semaforo -> tempo bloqueado
+    counts = defaultdict(lambda: defaultdict(int))
+
+    running = None
+    run_start = None
+    released = {}  # thread -> instante da liberacao pendente
+    waiting_start = {}  # thread -> instante da liberacao ainda sem CPU
+    blocked = {}  # thread -> (semaforo, instante)
+    isr_stack = []
+
+    for t, ev, arg in events:
+        if ev == EV_SWITCH:
+            if running is not None:
+                segments[running].append((run_start, t))
+            running, run_start = arg, t
+            if arg in waiting_start:
+                latency[arg].add(t - waiting_start.pop(arg))
+            if arg in blocked:
+                sem, t0 = blocked.pop(arg)
+                sem_block[sem].add(t - t0)
+        elif ev == EV_RELEASE:
+            counts[arg]["release"] += 1
+            released[arg] = t
+            if arg == running:
+                latency[arg].add(0)
+            else:
+                waiting_start[arg] = t
+        elif ev == EV_DONE:
+            counts[arg]["done"] += 1
+            if arg in released:
+                response[arg].add(t - released.pop(arg))
+        elif ev == EV_MISS:
+            counts[arg]["miss"] += 1
+        elif ev == EV_BUDGET:
+            counts[arg]["budget"] += 1
+        elif ev == EV_ISR_ENTER:
+            isr_stack.append((arg, t))
+        elif ev == EV_ISR_EXIT:
+            if isr_stack and isr_stack[-1][0] == arg:
+                _, t0 = isr_stack.pop()
+                isr_time[arg].add(t - t0)
+                isr_segments[arg].append((t0, t))
+        elif ev == EV_SEM_BLOCK:
+            if running is not None:
+                blocked[running] = (arg, t)
+            counts[("sem", arg)]["block"] += 1
+        elif ev == EV_SEM_TAKE:
+            counts[("sem", arg)]["take"] += 1
+        elif ev == EV_SEM_GIVE:
+            counts[("sem", arg)]["give"] += 1
+    if running is not None and events:
+        segments[running].append((run_start, events[-1][0]))
+
+    return {
+        "segments": segments,
+        "isr_segments": isr_segments,
+        "response": response,
+        "latency": latency,
+        "isr_time": isr_time,
+        "sem_block": sem_block,
+        "counts": counts,
+    }
+
+
+def thread_name(names, idx):
+    if idx in names:
+        return names[idx]
+    return "idle" if idx == 0 else "T%d" % idx
+
+
+def isr_name(exc):
+    return EXC_NAMES.get(exc, "IRQ%d" % (exc - 16))
+
+
+def print_report(r, events, names, us):
+    span = (events[-1][0] - events[0][0]) if events else 0
+    print("duracao: %.1f us, %d eventos" % (span * us, len(events)))
+    print()
+    print("tarefas (tempos em us)")
+    threads = sorted(set(r["segments"]) | {k for k in r["counts"] if isinstance(k, int)})
+    for idx in threads:
+        busy = sum(e - s for s, e in r["segments"].get(idx, []))
+        c = r["counts"][idx]
+        print("  %-16s cpu=%5.1f%% liberacoes=%d fins=%d perdas=%d orcamento=%d" % (
+            thread_name(names, idx), 100.0 * busy / span if span else 0.0,
+            c["release"], c["done"], c["miss"], c["budget"]))
+        if idx in r["response"]:
+            print("    resposta  %s" % r["response"][idx].row(us))
+        if idx in r["latency"]:
+            print("    latencia  %s" % r["latency"][idx].row(us))
+    if r["isr_time"]:
+        print()
+        print("ISRs (us)")
+        for exc in sorted(r["isr_time"]):
+            print("  %-16s %s" % (isr_name(exc), r["isr_time"][exc].row(us)))
+    sems = sorted(k[1] for k in r["counts"] if isinstance(k, tuple))
+    if sems:
+        print()
+        print("semaforos")
+        for sem in sems:
+            c = r["counts"][("sem", sem)]
+            print("  sem%-3d take=%d give=%d bloqueios=%d" % (
+                sem, c["take"], c["give"], c["block"]))
+            if sem in r["sem_block"]:
+                print("    bloqueado %s" % r["sem_block"][sem].row(us))
+
+
+def print_timeline(events, names, us):
+    t0 = events[0][0] if events else 0
+    for t, ev, arg in events:
+        if ev in (EV_ISR_ENTER, EV_ISR_EXIT):
+            who = isr_name(arg)
+        elif ev in (EV_SEM_TAKE, EV_SEM_BLOCK, EV_SEM_GIVE):
+            who = "sem%d" % arg
+        else:
+            who = thread_name(names, arg)
+        print("%12.1f  %-9s %s" % ((t - t0) * us, EV_NAMES[ev], who))
+
+
+def write_chrome(path, r, events, names, us):
+    """Trace Event Format (chrome://tracing, Perfetto): uma linha por thread."""
+    t0 = events[0][0] if events else 0
+    out = []
+    for idx, segs in r["segments"].items():
+        for s, e in segs:
+            out.append({"name": thread_name(names, idx), "ph": "X", "pid": 0,
+                        "tid": idx, "ts": (s - t0) * us, "dur": (e - s) * us})
+    for exc, segs in r["isr_segments"].items():
+        for s, e in segs:
+            out.append({"name": isr_name(exc), "ph": "X", "pid": 1,
+                        "tid": exc, "ts": (s - t0) * us, "dur": (e - s) * us})
+    for t, ev, arg in events:
+        if ev in (EV_RELEASE, EV_DONE, EV_MISS, EV_BUDGET):
+            out.append({"name": EV_NAMES[ev], "ph": "i", "s": "t", "pid": 0,
+                        "tid": arg, "ts": (t - t0) * us})
+    with open(path, "w") as f:
+        json.dump({"traceEvents": out}, f)
+
+
+def parse_names(text):
+    names = {}
+    for item in filter(None, (text or "").split(",")):
+        idx, name = item.split("=", 1)
+        names[int(idx)] = name
+    return names
+
+
+def main(argv=None):
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("swo", help="fluxo bruto do SWO (pacotes ITM)")
+    ap.add_argument("--clock", type=float, default=16e6,
+                    help="SystemCoreClock em Hz (padrao 16 MHz)")
+    ap.add_argument("--names", help="nomes das threads: 1=LerSensor,2=...")
+    ap.add_argument("--timeline", action="store_true",
+                    help="lista todos os eventos em vez do resumo")
+    ap.add_argument("--chrome", metavar="JSON",
+                    help="grava a linha do tempo no formato do chrome://tracing")
+    args = ap.parse_args(argv)
+
+    with open(args.swo, "rb") as f:
+        data = f.read()
+    events, overflows = decode(data)
+    names = parse_names(args.names)
+    us = 1e6 / args.clock
+
+    if overflows:
+        print("aviso: %d overflows do ITM, eventos perdidos" % overflows,
+              file=sys.stderr)
+    if args.timeline:
+        print_timeline(events, names, us)
+        return 0
+    r = analyze(events)
+    print_report(r, events, names, us)
+    if args.chrome:
+        write_chrome(args.chrome, r, events, names, us)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())